@@ -0,0 +1,97 @@
+# Gibt nach jedem Build die Flash- und RAM-Belegung pro Modul (Objektdatei) aus.
+# Grundlage ist die Linker-Map-Datei, die über build_flags in platformio.ini erzeugt wird.
+#
+# Einbindung in platformio.ini:
+#   build_flags = -Wl,-Map,${BUILD_DIR}/firmware.map
+#   extra_scripts = post:scripts/memory_report.py
+
+import os
+import re
+
+Import("env")
+
+SECTION_LINE = re.compile(r"^ (\.\S+|COMMON)\s+0x[0-9a-f]+\s+0x([0-9a-f]+)\s+(\S.*)$")
+SECTION_NAME = re.compile(r"^ (\.\S+|COMMON)$")
+SECTION_CONT = re.compile(r"^\s+0x[0-9a-f]+\s+0x([0-9a-f]+)\s+(\S.*)$")
+
+
+def classify(section):
+    if section.startswith((".debug", ".comment", ".stab", ".note", ".gnu")):
+        return None
+    if section.startswith(".data"):
+        return "data"
+    if section.startswith(".bss") or section == "COMMON" or section.startswith(".noinit"):
+        return "bss"
+    return "text"
+
+
+def module_name(path):
+    match = re.match(r"^(.*)\((.*)\)$", path)
+    if match:
+        library = os.path.basename(match.group(1))
+        library = re.sub(r"^lib|\.a$", "", library)
+        return library + "/" + re.sub(r"\.o$", "", match.group(2))
+    name = os.path.basename(path)
+    return re.sub(r"\.o$", "", name)
+
+
+def parse_map(path):
+    modules = {}
+    in_memory_map = False
+    pending = None
+    with open(path) as map_file:
+        for line in map_file:
+            line = line.rstrip("\n")
+            if not in_memory_map:
+                in_memory_map = line.startswith("Linker script and memory map")
+                continue
+            section = size = obj = None
+            match = SECTION_LINE.match(line)
+            if match:
+                section, size, obj = match.group(1), match.group(2), match.group(3)
+            elif pending:
+                match = SECTION_CONT.match(line)
+                if match:
+                    section, size, obj = pending, match.group(1), match.group(2)
+            pending = None
+            if not section:
+                match = SECTION_NAME.match(line)
+                if match:
+                    pending = match.group(1)
+                continue
+            kind = classify(section)
+            size = int(size, 16)
+            if kind is None or size == 0:
+                continue
+            entry = modules.setdefault(module_name(obj.strip()), {"text": 0, "data": 0, "bss": 0})
+            entry[kind] += size
+    return modules
+
+
+def report(target, source, env):
+    map_path = env.subst("$BUILD_DIR/firmware.map")
+    if not os.path.isfile(map_path):
+        print("memory_report: keine Map-Datei gefunden (%s)" % map_path)
+        return
+    modules = parse_map(map_path)
+    board = env.BoardConfig()
+    flash_max = int(board.get("upload.maximum_size", 30720))
+    ram_max = int(board.get("upload.maximum_ram_size", 2048))
+
+    print("")
+    print("Speicherbelegung pro Modul (Flash = text + data, RAM = data + bss):")
+    print("%-40s %8s %8s" % ("Modul", "Flash", "RAM"))
+    flash_total = ram_total = 0
+    rows = sorted(modules.items(), key=lambda item: -(item[1]["text"] + item[1]["data"]))
+    for name, entry in rows:
+        flash = entry["text"] + entry["data"]
+        ram = entry["data"] + entry["bss"]
+        flash_total += flash
+        ram_total += ram
+        print("%-40s %8d %8d" % (name[:40], flash, ram))
+    print("%-40s %8d %8d" % ("Summe", flash_total, ram_total))
+    print("%-40s %7.1f%% %7.1f%%" % ("Anteil", 100.0 * flash_total / flash_max, 100.0 * ram_total / ram_max))
+    print("Frei fuer Stack: %d Bytes (Laufzeit-Maximum ueber Befehl 'mem' auf der Seriellen Konsole)" % (ram_max - ram_total))
+
+
+env.AddPostAction("$BUILD_DIR/${PROGNAME}.elf", report)
@@ -0,0 +1,145 @@
+/* MIT License
+
+Copyright (c) 2024 mva-one
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ */
+
+#include "eeprom_queue.h"
+#include <util/atomic.h>
+
+struct EepromSegment {
+  uint16_t addr;        // nächste zu schreibende Adresse
+  uint16_t len;         // verbleibende Bytes
+  bool fill;            // true: alle Bytes = value, sonst aus dem Datenpuffer
+  uint8_t value;
+};
+
+// Ringpuffer, die ISR arbeitet am Anfang (head), eingereiht wird am Ende (tail)
+static uint8_t queue_data[EEPROM_QUEUE_DATA];
+static volatile uint8_t data_head = 0;
+static volatile uint8_t data_count = 0;
+static EepromSegment segments[EEPROM_QUEUE_SEGMENTS];
+static volatile uint8_t segment_head = 0;
+static volatile uint8_t segment_count = 0;
+
+volatile EepromQueueStats eeprom_queue_stats;
+
+static inline uint8_t wrapData(uint8_t index) {
+  return index >= EEPROM_QUEUE_DATA ? index - EEPROM_QUEUE_DATA : index;
+}
+
+static inline uint8_t wrapSegment(uint8_t index) {
+  return index >= EEPROM_QUEUE_SEGMENTS ? index - EEPROM_QUEUE_SEGMENTS : index;
+}
+
+// Wartet mit freigegebenen Interrupts, bis die ISR genug Platz geschaffen hat, und gibt den
+// Abschnitt zurück, an den angehängt werden kann (nullptr: neuer Abschnitt nötig).
+// Danach sind die Interrupts gesperrt, der Aufrufer gibt sie mit SREG wieder frei.
+static EepromSegment* reserve(uint16_t addr, uint8_t len, bool fill, uint8_t value) {
+  bool waited = false;
+  for (;;) {
+    cli();
+    EepromSegment* last = segment_count
+      ? &segments[wrapSegment(segment_head + segment_count - 1)] : nullptr;
+    bool append = last && last->fill == fill && last->addr + last->len == addr && (!fill || last->value == value);
+    if (data_count + len <= EEPROM_QUEUE_DATA && (append || segment_count < EEPROM_QUEUE_SEGMENTS)) {
+      if (waited) eeprom_queue_stats.waits++;
+      return append ? last : nullptr;
+    }
+    waited = true;
+    sei();
+  }
+}
+
+static EepromSegment* appendSegment(uint16_t addr, bool fill, uint8_t value) {
+  EepromSegment* segment = &segments[wrapSegment(segment_head + segment_count)];
+  segment->addr = addr;
+  segment->len = 0;
+  segment->fill = fill;
+  segment->value = value;
+  segment_count++;
+  return segment;
+}
+
+void eepromQueueWrite(uint16_t addr, const void* data, uint8_t len) {
+  if (len == 0) return;
+  uint8_t sreg = SREG;
+  EepromSegment* segment = reserve(addr, len, false, 0);
+  if (!segment) segment = appendSegment(addr, false, 0);
+  const uint8_t* bytes = (const uint8_t*)data;
+  uint8_t tail = wrapData(data_head + data_count);
+  for (uint8_t i = 0; i < len; i++) {
+    queue_data[tail] = bytes[i];
+    tail = wrapData(tail + 1);
+  }
+  data_count += len;
+  segment->len += len;
+  EECR |= _BV(EERIE);
+  SREG = sreg;
+}
+
+void eepromQueueFill(uint16_t addr, uint16_t count, uint8_t value) {
+  if (count == 0) return;
+  uint8_t sreg = SREG;
+  EepromSegment* segment = reserve(addr, 0, true, value);
+  if (!segment) segment = appendSegment(addr, true, value);
+  segment->len += count;
+  EECR |= _BV(EERIE);
+  SREG = sreg;
+}
+
+bool eepromQueueBusy() {
+  return segment_count || (EECR & _BV(EEPE));
+}
+
+// EEPROM bereit: nächstes geändertes Byte schreiben. Ist die Warteschlange leer, wird der
+// Interrupt abgeschaltet (er würde sonst bei bereitem EEPROM dauernd auslösen).
+ISR(EE_READY_vect) {
+  for (uint8_t checked = 0; checked < EEPROM_QUEUE_SKIP_MAX; checked++) {
+    if (!segment_count) {
+      EECR &= ~_BV(EERIE);
+      return;
+    }
+    EepromSegment* segment = &segments[segment_head];
+    uint16_t addr = segment->addr++;
+    uint8_t value = segment->value;
+    if (!segment->fill) {
+      value = queue_data[data_head];
+      data_head = wrapData(data_head + 1);
+      data_count--;
+    }
+    if (--segment->len == 0) {
+      segment_head = wrapSegment(segment_head + 1);
+      segment_count--;
+    }
+
+    EEAR = addr;
+    EECR |= _BV(EERE);
+    if (EEDR != value) {
+      // Löschen + Schreiben in einem Vorgang (EEPM = 0), EEPE muss max. 4 Takte nach EEMPE folgen
+      EEDR = value;
+      EECR |= _BV(EEMPE);
+      EECR |= _BV(EEPE);
+      eeprom_queue_stats.written++;
+      return;
+    }
+    eeprom_queue_stats.skipped++;
+  }
+}
@@ -0,0 +1,78 @@
+/* MIT License
+
+Copyright (c) 2024 mva-one
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+
+/*
+    Schreib-Warteschlange für das EEPROM, abgearbeitet im EE_READY-Interrupt.
+
+    Ein Byte zu schreiben dauert ca. 3,3 ms, EEPROM.put() wartet das für jedes Byte ab und blockiert
+    damit loop, Anzeige und Regelung. Hier werden die Daten nur ins RAM kopiert und die ISR schreibt
+    sie Byte für Byte, sobald das EEPROM bereit ist. Unveränderte Bytes werden übersprungen (wie bei
+    EEPROM.update()), je ISR-Aufruf werden max. EEPROM_QUEUE_SKIP_MAX Bytes verglichen, damit die
+    ISR kurz bleibt. Die Reihenfolge bleibt erhalten: ein zuletzt eingereihtes "gespeichert"-Flag
+    steht erst im EEPROM, wenn alle Daten davor geschrieben sind.
+
+    Solange die Warteschlange nicht leer ist, darf das EEPROM nicht direkt (EEPROM.get/put/read,
+    eeprom_*) benutzt werden, da die ISR das Adressregister EEAR verwendet. Die Firmware liest das
+    EEPROM nur in setup(), dort ist die Warteschlange noch leer.
+
+    Reicht der Platz nicht, wartet eepromQueueWrite(), bis die ISR genug abgearbeitet hat. Die
+    Funktionen daher nicht aus einer ISR aufrufen.
+ */
+
+// Puffer für die Datenbytes, reicht für eine komplette Kalibrierung (75 Bytes)
+#define EEPROM_QUEUE_DATA 96
+
+// Anzahl Abschnitte (zusammenhängende Adressbereiche), aneinander anschließende Schreibvorgänge
+// werden zu einem Abschnitt zusammengefasst
+#define EEPROM_QUEUE_SEGMENTS 8
+
+// max. übersprungene (unveränderte) Bytes je ISR-Aufruf
+#define EEPROM_QUEUE_SKIP_MAX 8
+
+struct EepromQueueStats {
+  uint16_t written;     // tatsächlich geschriebene Bytes
+  uint16_t skipped;     // übersprungene, da unverändert
+  uint16_t waits;       // Aufrufe, die auf freien Platz warten mussten
+};
+
+extern volatile EepromQueueStats eeprom_queue_stats;
+
+// len Bytes ab data an Adresse addr schreiben (len <= EEPROM_QUEUE_DATA)
+void eepromQueueWrite(uint16_t addr, const void* data, uint8_t len);
+
+// count Bytes ab addr mit value füllen, belegt keinen Datenpuffer
+void eepromQueueFill(uint16_t addr, uint16_t count, uint8_t value);
+
+// true, solange noch Bytes ausstehen oder ein Schreibvorgang läuft
+bool eepromQueueBusy();
+
+// Gegenstück zu EEPROM.put()
+template <typename T>
+inline void eepromQueuePut(uint16_t addr, const T& value) {
+  static_assert(sizeof(T) <= EEPROM_QUEUE_DATA, "Wert zu gross fuer die EEPROM-Warteschlange");
+  eepromQueueWrite(addr, &value, sizeof(T));
+}
@@ -0,0 +1,57 @@
+/* MIT License
+
+Copyright (c) 2024 mva-one
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ */
+
+#pragma once
+
+#include <avr/io.h>
+
+/*
+    Direkter Pin-Zugriff für den ATmega328P (Arduino Nano), zur Compile-Zeit aufgelöst.
+
+    Anders als digitalWrite()/digitalRead() werden keine Tabellen im Flash durchsucht:
+    Port und Bitmaske stehen schon beim Kompilieren fest, ein Schreibzugriff wird so zu
+    einem einzelnen sbi/cbi-Befehl (2 Takte), ein Lesezugriff zu sbic/sbis bzw. in+andi.
+
+    Arduino-Pin-Nummern:  0-7 -> PORTD,  8-13 -> PORTB,  14-19 (A0-A5) -> PORTC
+ */
+template <uint8_t PIN>
+struct FastPin {
+  static_assert(PIN < 20, "Pin existiert auf dem ATmega328P nicht");
+
+  static constexpr uint8_t bit = PIN < 8 ? PIN : (PIN < 14 ? PIN - 8 : PIN - 14);
+  static constexpr uint8_t mask = 1 << bit;
+
+  static inline volatile uint8_t& port() __attribute__((always_inline)) { return PIN < 8 ? PORTD : (PIN < 14 ? PORTB : PORTC); }
+  static inline volatile uint8_t& ddr() __attribute__((always_inline)) { return PIN < 8 ? DDRD : (PIN < 14 ? DDRB : DDRC); }
+  static inline volatile uint8_t& pin() __attribute__((always_inline)) { return PIN < 8 ? PIND : (PIN < 14 ? PINB : PINC); }
+
+  static inline void high() __attribute__((always_inline)) { port() |= mask; }
+  static inline void low() __attribute__((always_inline)) { port() &= ~mask; }
+  static inline void write(bool value) __attribute__((always_inline)) { if (value) high(); else low(); }
+  static inline void toggle() __attribute__((always_inline)) { pin() = mask; }
+  static inline bool read() __attribute__((always_inline)) { return pin() & mask; }
+
+  static inline void output() __attribute__((always_inline)) { ddr() |= mask; }
+  static inline void input() __attribute__((always_inline)) { ddr() &= ~mask; port() &= ~mask; }
+  static inline void inputPullup() __attribute__((always_inline)) { ddr() &= ~mask; port() |= mask; }
+};
@@ -0,0 +1,64 @@
+/* MIT License
+
+Copyright (c) 2024 mva-one
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ */
+
+#include "format.h"
+
+const uint32_t fmt_decimal[5] PROGMEM = {10000, 1000, 100, 10, 1};
+const uint32_t fmt_duration_ms[4] PROGMEM = {600000, 60000, 10000, 1000};
+const uint32_t fmt_kilo[4] PROGMEM = {1000000, 100000, 10000, 1000};
+
+void formatPlaces(uint32_t value, const uint32_t* places, uint8_t count, char* out, uint8_t blank) {
+  for (uint8_t i = 0; i < count; i++) {
+    uint32_t place = pgm_read_dword(&places[i]);
+    char digit = '0';
+    while (value >= place) {
+      value -= place;
+      digit++;
+    }
+    if (digit == '0' && i < blank) digit = ' ';
+    else blank = 0;
+    *out++ = digit;
+  }
+}
+
+bool formatWeight(uint32_t grams, uint8_t decimals, char* out, bool blank) {
+  if (decimals >= 2 && grams < FMT_WEIGHT_DECI_FROM) {
+    // 1 kg, 0.1 kg, 0.01 kg
+    formatPlaces(grams, fmt_decimal + 1, 3, out + 1);
+    out[0] = out[1];
+    out[1] = '.';
+    return true;
+  }
+  if (grams < FMT_WEIGHT_KILO_FROM) {
+    // 10 kg, 1 kg, 0.1 kg
+    formatPlaces(grams, fmt_decimal, 3, out, blank ? 1 : 0);
+    out[3] = out[2];
+    out[2] = '.';
+    return true;
+  }
+  if (grams < 10 * pgm_read_dword(&fmt_kilo[0])) {
+    formatPlaces(grams, fmt_kilo, 4, out, 3);
+    return true;
+  }
+  return false;
+}
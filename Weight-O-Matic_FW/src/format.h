@@ -0,0 +1,66 @@
+/* MIT License
+
+Copyright (c) 2024 mva-one
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+
+/*
+    Zerlegung von Zahlen in Ziffern für die Anzeige, ohne Division.
+
+    Eine 32-Bit-Division (/ oder %) ist auf dem AVR ein Unterprogramm mit mehreren hundert
+    Takten, die Anzeige eines Gewichts brauchte bisher fünf davon plus die Divisionen in
+    lcd.print(). Hier wird jede Stelle durch wiederholtes Abziehen ihres Stellenwerts bestimmt
+    (max. 9 Subtraktionen je Stelle). Die Stellenwerte liegen als Tabelle im Flash, so lassen
+    sich auch gemischte Basen wie Minuten/Sekunden abbilden.
+
+    Der Wert muss kleiner als 10 x erster Stellenwert sein, sonst ist die erste Ziffer ungültig.
+ */
+
+// Dezimal-Stellenwerte 10000 ... 1
+extern const uint32_t fmt_decimal[5] PROGMEM;
+
+// Zeitdauer in ms als m:ss -> 10 min, 1 min, 10 s, 1 s (Rest < 1 s entfällt)
+extern const uint32_t fmt_duration_ms[4] PROGMEM;
+
+// Gramm in ganzen kg: 1000 kg ... 1 kg
+extern const uint32_t fmt_kilo[4] PROGMEM;
+
+// Bereichsgrenzen (g) der automatischen Bereichswahl von formatWeight()
+#define FMT_WEIGHT_DECI_FROM 10000      // ab 10 kg nur noch 0,1 kg Auflösung
+#define FMT_WEIGHT_KILO_FROM 100000     // ab 100 kg nur noch ganze kg
+
+// Schreibt count Ziffern als ASCII nach out. Die ersten blank Stellen werden, solange sie
+// führende Nullen sind, als Leerzeichen ausgegeben.
+void formatPlaces(uint32_t value, const uint32_t* places, uint8_t count, char* out, uint8_t blank = 0);
+
+// Gewicht (g, >= 0) als 4 Zeichen mit automatischer Bereichswahl: "d.dd" (nur mit decimals = 2,
+// bis 9,99 kg), "dd.d" bis 99,9 kg, darüber ganze kg "dddd". Abgeschnitten wird wie bei
+// formatPlaces(), nicht gerundet. blank: führende Null als Leerzeichen. Gibt false zurück, wenn
+// der Wert auch in ganzen kg nicht in 4 Stellen passt (ab 10000 kg), out ist dann unverändert.
+bool formatWeight(uint32_t grams, uint8_t decimals, char* out, bool blank = true);
+
+// Die letzten count Dezimalstellen (count <= 5)
+inline void formatDecimal(uint32_t value, uint8_t count, char* out, uint8_t blank = 0) {
+  formatPlaces(value, fmt_decimal + 5 - count, count, out, blank);
+}
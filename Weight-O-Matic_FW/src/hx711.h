@@ -0,0 +1,177 @@
+/* MIT License
+
+Copyright (c) 2024 mva-one
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include <util/atomic.h>
+#include "fastpin.h"
+
+// Anzahl Messwerte für den gleitenden Mittelwert (wie Standard bei HX711_ADC)
+#define HX711_SAMPLES 16
+
+// Max. Wartezeit (ms) auf einen Messwert beim blockierenden Tara / Neueinlesen
+#define HX711_TIMEOUT 500
+
+// Endwerte des Rohwerts (Offset-Binär, siehe unten): -8388608 bzw. +8388607, der HX711 gibt
+// sie bei Übersteuerung aus
+#define HX711_RAW_MIN 0x000000L
+#define HX711_RAW_MAX 0xFFFFFFL
+
+/*
+    Treiber für den HX711 (Kanal A, Verstärkung 128), ersetzt die Library HX711_ADC.
+
+    Schnittstelle und Zahlendarstellung sind kompatibel zu HX711_ADC, damit die im EEPROM
+    gespeicherten Tara-/Kalibrierungswerte weiter gelten: der 24-Bit-Rohwert wird mit
+    0x800000 XOR-verknüpft (Offset-Binär, 0x800000 = 0), gemittelt und dann über
+    (Mittelwert - Tara-Offset) / Kalibrierungsfaktor in Gramm umgerechnet.
+ */
+template <uint8_t PIN_DOUT, uint8_t PIN_SCK>
+class Hx711 {
+  typedef FastPin<PIN_DOUT> Dout;
+  typedef FastPin<PIN_SCK> Sck;
+
+  public:
+    void begin() {
+      Dout::input();
+      Sck::output();
+      Sck::low();   // SCK low -> HX711 eingeschaltet
+    }
+
+    // Wartet die Einschwingzeit ab und füllt dabei den Mittelwert-Puffer.
+    // Kommt in dieser Zeit kein Messwert, wird das Signal-Timeout-Flag gesetzt.
+    void start(uint32_t t_stabilize, bool do_tare = false) {
+      uint32_t t_start = millis();
+      signal_timeout = true;
+      while (millis() - t_start < t_stabilize) {
+        if (update()) signal_timeout = false;
+      }
+      if (do_tare) tare();
+    }
+
+    // Liest einen Messwert, falls der HX711 eine Wandlung abgeschlossen hat (DOUT low)
+    bool update() {
+      if (Dout::read()) return false;
+      push(readRaw());
+      return true;
+    }
+
+    bool isReady() { return !Dout::read(); }
+    bool isFilled() { return filled >= samples; }
+
+    float getData() { return (float)(getSmoothedData() - tare_offset) / cal_factor; }
+
+    long getSmoothedData() { return filled ? sum / filled : 0; }
+    long getRawData() { return last_raw; }
+
+    // Länge des gleitenden Mittelwerts (1 ... HX711_SAMPLES), der Puffer wird neu gefüllt
+    void setSamples(uint8_t count) {
+      samples = count < 1 ? 1 : count > HX711_SAMPLES ? HX711_SAMPLES : count;
+      filled = 0;
+      sum = 0;
+      index = 0;
+    }
+    uint8_t getSamples() { return samples; }
+
+    void setCalFactor(float factor) { cal_factor = factor; }
+    float getCalFactor() { return cal_factor; }
+    void setTareOffset(long offset) { tare_offset = offset; }
+    long getTareOffset() { return tare_offset; }
+
+    bool getTareTimeoutFlag() { return tare_timeout; }
+    bool getSignalTimeoutFlag() { return signal_timeout; }
+
+    // Blockiert, bis der Mittelwert-Puffer komplett mit neuen Messwerten gefüllt ist
+    void refreshDataSet() {
+      filled = 0;
+      sum = 0;
+      index = 0;
+      uint32_t t_sample = millis();
+      while (filled < samples) {
+        if (update()) t_sample = millis();
+        else if (millis() - t_sample > HX711_TIMEOUT) { tare_timeout = true; return; }
+      }
+    }
+
+    void tare() {
+      tare_timeout = false;
+      refreshDataSet();
+      if (!tare_timeout) tare_offset = getSmoothedData();
+    }
+
+    float getNewCalibration(float known_mass) {
+      cal_factor = (float)(getSmoothedData() - tare_offset) / known_mass;
+      return cal_factor;
+    }
+
+  private:
+    // Liest 24 Bit + 1 Takt für Kanal A / Verstärkung 128. Interrupts müssen gesperrt sein,
+    // da SCK nicht länger als 60 us high bleiben darf (sonst schaltet der HX711 ab).
+    // Zeitverhalten bei 16 MHz: SCK high >= 5 Takte (312 ns, min. 200 ns laut Datenblatt),
+    // DOUT wird erst nach der fallenden Flanke gelesen (gültig 100 ns nach der steigenden).
+    static inline uint8_t shiftInByte() __attribute__((always_inline)) {
+      uint8_t value = 0;
+      for (uint8_t i = 0; i < 8; i++) {
+        Sck::high();
+        __builtin_avr_delay_cycles(3);
+        Sck::low();
+        value <<= 1;
+        if (Dout::read()) value |= 1;
+      }
+      return value;
+    }
+
+    static long readRaw() {
+      uint8_t b2, b1, b0;
+      ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        b2 = shiftInByte();
+        b1 = shiftInByte();
+        b0 = shiftInByte();
+        Sck::high();
+        __builtin_avr_delay_cycles(3);
+        Sck::low();
+      }
+      return ((uint32_t)(b2 ^ 0x80) << 16) | ((uint16_t)b1 << 8) | b0;
+    }
+
+    void push(long raw) {
+      last_raw = raw;
+      if (filled < samples) filled++;
+      else sum -= buffer[index];
+      buffer[index] = raw;
+      sum += raw;
+      if (++index >= samples) index = 0;
+    }
+
+    long buffer[HX711_SAMPLES];
+    long sum = 0;
+    uint8_t index = 0;
+    uint8_t filled = 0;
+    uint8_t samples = HX711_SAMPLES;
+    long last_raw = 0;
+
+    long tare_offset = 0;
+    float cal_factor = 1.0f;
+    bool tare_timeout = false;
+    bool signal_timeout = false;
+};
@@ -22,25 +22,31 @@ SOFTWARE.
  */
 
 #include <Arduino.h>
-#include <HX711_ADC.h>
+#include <limits.h>
 #include <EEPROM.h>
 #include <LCD_I2C.h>
 #include <Wire.h>
-#include <CtrlBtn.h>
-#include <CtrlEnc.h>
-
-#define VERSION F("v0.8")
+#include <util/atomic.h>
+#include "fastpin.h"
+#include "eeprom_queue.h"
+#include "format.h"
+#include "hx711.h"
+#include "screen.h"
+#include "texts.h"
 
 #define PIN_BEEP 9              // 9 <-(rot)-> Piepser
 #define PIN_SW_1 5              // 5 <-(braun)-> Schalter 'I'
 #define PIN_SW_COM 6            // 6 <-(schwarz)-> Schalter Common
 #define PIN_SW_2 7              // 7 <-(braun)-> Schalter 'II'
 #define PIN_OUTPUT 8            // 8 <-(rot)-> Schaltmodul
+#define PIN_OUTPUT_2 14         // A0 <-> Schaltmodul Ausgang 2 (nur für Rezepte)
+#define PIN_OUTPUT_3 15         // A1 <-> Schaltmodul Ausgang 3 (nur für Rezepte)
 #define PIN_HX711_DAT 11        // 11 <-(grün)-> DT HX711
 #define PIN_HX711_SCK 10        // 10 <-(weiß)-> SCK HX711
 #define PIN_ENCODER_CLK 3       // 3 <-(blau)-> CLK Dreh/Drückschalter
 #define PIN_ENCODER_DAT 4       // 4 <-(grün)-> DAT Dreh/Drückschalter
 #define PIN_ENCODER_BTN 2       // 2<-(braun)-> SW Dreh/Drückschalter
+#define PIN_MODBUS_DE 12        // 12 <-> DE + /RE RS-485-Transceiver (nur mit MODBUS_ENABLED)
 // I2C Pins sind default:       // A5 <-(blau)-> SCL     A4 <-(grün)-> SDA  
 
 // Tonhöhen und -Längen für Tastentöne
@@ -48,10 +54,11 @@ SOFTWARE.
 #define BEEP_FREQ_RIGHT 1100
 #define BEEP_FREQ_CLICK 925
 #define BEEP_FREQ_ERR 440
-#define BEEP_LENGTH_TURN 15
+#define BEEP_LENGTH_TURN 15       // Längen (ms) sind Vorgabewerte der Parameter-Registry
 #define BEEP_LENGTH_SHORT 40
 #define BEEP_LENGTH_LONG 250
 #define BEEP_LENGTH_ERR 300
+#define BEEP_MIN_INTERVAL_TURN 60   // schnelles Drehen: höchstens ein Dreh-Ton in diesem Abstand (ms)
 
 // Tonhöhen in Hz und "Takt" für Ende-Melodie
 #define BEEP_FREQ_A5 880
@@ -64,6 +71,20 @@ SOFTWARE.
 // Debug-Ausgaben über die Serielle Konsole aktivieren (Baud 115200)
 #define SERIAL_ENABLED
 
+// Modbus-RTU-Slave über RS-485 (19200 Baud, 8E1) aktivieren. Belegt den UART und Timer 1,
+// deshalb nur ohne SERIAL_ENABLED möglich. Registerbelegung siehe Abschnitt "Modbus RTU".
+// #define MODBUS_ENABLED
+#define DEFAULT_MODBUS_ADDRESS 1
+
+#if defined(MODBUS_ENABLED) && defined(SERIAL_ENABLED)
+#error "MODBUS_ENABLED und SERIAL_ENABLED teilen sich den UART, bitte nur eins aktivieren!"
+#endif
+
+#ifdef MODBUS_ENABLED
+#define MODBUS_PIN_DE PIN_MODBUS_DE
+#include "modbus.h"
+#endif
+
 // Standardwerte, werden bei leerem EEPROM geladen (z.B. auch nach dem Zurücksetzen über das Menü)
 #define DEFAULT_WEIGHT_TARGET_NO_PRESET 4200
 #define DEFAULT_CAL_FACTOR 28.44
@@ -74,15 +95,41 @@ SOFTWARE.
 #define DEFAULT_P2_OFFSET 2000
 #define DEFAULT_TOGGLESETTINGS 0b11000000
 
+// max. Anzahl Kalibrierpunkte (bekannte Massen) für die stückweise lineare Kennlinie
+#define CAL_POINTS_MAX 8
+
 #define MAX_WEIGHT_CALIB 99990
 #define MIN_WEIGHT_CALIB 10
-#define MAX_WEIGHT_SETPOINT 99990
+#define MAX_WEIGHT_SETPOINT 999900
 #define MIN_WEIGHT_SETPOINT 100
 #define MIN_WEIGHT_OFFSET 0
-#define MAX_WEIGHT_OFFSET 9990
+#define MAX_WEIGHT_OFFSET 99990
 
 #define SETTINGS_KEYTONE 7
 #define SETTINGS_ENDTONE 6
+#define SETTINGS_AUTOCYCLE 5
+#define SETTINGS_DIRECTEDIT 4
+#define SETTINGS_TOPUP 3
+#define SETTINGS_DEGRADED 2
+
+// Einträge im Einstellungsmenü (Zustand 26), je Seite 6 Stück, der erste einer Seite ist immer "zurück"
+#define SETTINGS_MENU_ENTRIES 15
+
+// Kleinste Schrittweite (g) bei der Ganzwert-Eingabe, entspricht der letzten angezeigten Stelle
+#define DIRECTEDIT_STEP_TARGET 100
+#define DIRECTEDIT_STEP_OFFSET 10
+#define DIRECTEDIT_STEP_CALIB 10
+
+// Stillstandserkennung: Gewicht muss mind. t_stable (ms) innerhalb dieses Bands (g) bleiben
+#define STABLE_BAND_G 20
+
+// Auto-Zyklus: zulässige Abweichung (g) eines leeren Behälters vom Tara-Versatz der VE bzw.
+// Mindestgewicht (g) eines leeren Behälters ohne VE
+#define AUTOCYCLE_TARE_BAND_G 200
+#define AUTOCYCLE_MIN_CONTAINER_G 100
+
+// Nachfüllen: Ventil öffnet wieder, wenn netto um diesen Anteil (%) unter den Sollwert fällt
+#define TOPUP_HYSTERESIS_PERCENT 10
 
 
 // EEPROM-Adressen für verschiedene Einstellungen:
@@ -100,15 +147,122 @@ const uint16_t addr_p2_saved_flag = 0x31;   // stores bool (1B) - addr. 0x31
 
 const uint16_t addr_toggle_settings = 0x32;       // stores byte      - addr. 0x32
 const uint16_t addr_settings_saved_flag = 0x33;   // stores bool (1B) - addr. 0x33
+const uint16_t addr_modbus_address = 0x34;        // stores byte      - addr. 0x34
+const uint16_t addr_filter_window = 0x35;         // stores byte      - addr. 0x35
+const uint16_t addr_filter_window_saved_flag = 0x36; // stores bool (1B) - addr. 0x36
+const uint16_t addr_curve_interval = 0x37;        // stores byte      - addr. 0x37
+
+const uint16_t addr_cal_points_count = 0x40;      // stores byte      - addr. 0x40
+const uint16_t addr_cal_points_saved_flag = 0x41; // stores bool (1B) - addr. 0x41
+const uint16_t addr_cal_points = 0x42;            // stores 8x (long raw, long mass) - addr. 0x42 - 0x81
+
+// 0x90 - 0xAF: frei (früher Füll-Journal als Einzel-Eintrag)
+
+const uint16_t addr_flow_saved_flag = 0xB0;      // stores bool (1B) - addr. 0xB0
+const uint16_t addr_flow_rates = 0xB1;            // stores 3x FlowRate (3B) - addr. 0xB1 - 0xB9
+
+const uint16_t addr_overshoot_saved_flag = 0xC0;  // stores bool (1B) - addr. 0xC0
+const uint16_t addr_overshoot = 0xC1;             // stores 3x OvershootStats (12B) - addr. 0xC1 - 0xE4
+
+const uint16_t addr_containers = 0xF0;            // stores 8x Container (10B) - addr. 0xF0 - 0x13F
+
+const uint16_t addr_params_saved_flag = 0x140;    // stores bool (1B) - addr. 0x140
+const uint16_t addr_params = 0x141;               // Parameter-Registry, Adressen siehe params[] - addr. 0x141 - 0x19F
 
-// Intervall (ms) zum Auslesen des VE-Schalters
-const uint32_t t_intv_switch = 276;
+const uint16_t addr_recipes = 0x1A0;              // stores 2x Recipe (29B) - addr. 0x1A0 - 0x1D9
+
+const uint16_t addr_capture = 0x1E0;              // stores CaptureHeader (13B) + 32x CaptureSample (4B) - addr. 0x1E0 - 0x26C
+
+const uint16_t addr_fill_journal = 0x270;         // stores 4x FillJournal (16B) - addr. 0x270 - 0x2AF
+
+const uint16_t addr_curves = 0x2B0;               // stores 3x fill curve (112B) - addr. 0x2B0 - 0x3FF
+
+/*
+    Zeiten, Tonlängen, Bänder und Eingabegrenzen sind zur Laufzeit über die Parameter-Registry
+    (Menü "PAR" bzw. serielle Befehle "params" / "get" / "set") einstellbar. Die DEFAULT_- bzw.
+    oben definierten Werte sind die Vorgaben, gültig sind die Werte aus dem EEPROM.
+ */
+
+// Entprellzeit (ms) des VE-Schalters nach einer per Interrupt erkannten Änderung
+#define DEFAULT_T_DEBOUNCE_SWITCH 30
+uint16_t t_debounce_switch = DEFAULT_T_DEBOUNCE_SWITCH;
+
+// Entprellzeit (ms) und Mindestdauer (ms) für langen Klick des Dreh-Drück-Knopfs
+#define DEFAULT_T_DEBOUNCE_BUTTON 20
+#define DEFAULT_T_LONG_CLICK 500
+uint16_t t_debounce_button = DEFAULT_T_DEBOUNCE_BUTTON;
+uint16_t t_long_click = DEFAULT_T_LONG_CLICK;
+
+// Beschleunigung beim Drehen: je kürzer der Abstand (ms) zur vorherigen Rastung in gleicher
+// Richtung, desto größer der Faktor auf die Schrittweite. Der erste passende Eintrag gilt.
+struct EncoderAccel {
+  uint8_t max_interval_ms;
+  uint8_t factor;
+};
+const EncoderAccel encoder_accel[] PROGMEM = {
+  { 25,  50 },
+  { 50,  10 },
+  { 100,  4 },
+  { 255,  1 },    // langsamer: immer Faktor 1
+};
 
 // Mindest-Intervall (ms) für die Display-Aktualisierung 
-const uint32_t t_intv_screen = 100; 
+#define DEFAULT_T_INTV_SCREEN 100
+uint16_t t_intv_screen = DEFAULT_T_INTV_SCREEN;
+
+// Mindestdauer (ms) für die Stillstandserkennung
+#define DEFAULT_T_STABLE 1000
+uint16_t t_stable = DEFAULT_T_STABLE;
+
+// Auto-Zyklus: Wartezeit (ms) nach Aufstellen eines leeren Behälters bis zum automatischen Start
+// (max. 9 s, die Restzeit wird einstellig angezeigt)
+#define DEFAULT_T_AUTOCYCLE_CONFIRM 3000
+uint16_t t_autocycle_confirm = DEFAULT_T_AUTOCYCLE_CONFIRM;
+
+// Nachfüllen: Mindest-Pausenzeit (ms) zwischen Schließen und erneutem Öffnen des Ventils,
+// schützt Magnetventil und Osmose-Membran vor häufigem Takten
+#define DEFAULT_T_TOPUP_MIN_OFF 60000
+uint32_t t_topup_min_off = DEFAULT_T_TOPUP_MIN_OFF;
+
+// Notbetrieb: Füllmenge in % des Sollwerts und maximale Füllzeit (s) einer zeitgesteuerten Befüllung
+#define DEFAULT_DEGRADED_PERCENT 80
+#define DEFAULT_T_DEGRADED_MAX 300
+
+// Überwachung der Wiegezelle: größter plausibler Sprung (g) zwischen zwei Messwerten und
+// max. Zeit (ms) ohne Anstieg bei offenem Ventil (0 = aus)
+#define DEFAULT_FAULT_STEP_G 50000
+#define DEFAULT_T_FAULT_FROZEN 15000
+
+// Nachlauf: max. Wartezeit (s) auf Stillstand nach dem Schließen, sonst wird nichts erfasst
+#define DEFAULT_T_SETTLE_MAX 20
+
+// Aufzeichnung am Abschaltpunkt: Anzahl Messwerte nach dem Schließen (0 = aus), der Rest des
+// Puffers sind die Messwerte davor
+#define DEFAULT_CAPTURE_POST 16
+
+// Aufzeichnung am Abschaltpunkt: Mindestabstand (min) zwischen zwei automatischen Speicherungen
+// ins EEPROM (0 = nur mit "capture save")
+#define DEFAULT_CAPTURE_SAVE_MIN 60
+
+// Rauschtest: z-Wert (in 1/100) für den Vorschlag des Mittelwert-Fensters, 372 = einseitig
+// ca. 1:10000 Fehlauslösung je Messwert
+#define DEFAULT_NOISETEST_Z 372
 
 // Timeout (ms) für Kommunikation mit Wiegezelle
-const uint32_t t_timeout_weight_reading = 2024;
+#define DEFAULT_T_TIMEOUT_WEIGHT_READING 2024
+uint16_t t_timeout_weight_reading = DEFAULT_T_TIMEOUT_WEIGHT_READING;
+uint32_t t_last_weight_reading = 0;
+
+// Tonlängen (ms), Bänder (g) und Eingabegrenzen (g), Vorgaben siehe #defines oben
+uint16_t beep_length_turn = BEEP_LENGTH_TURN;
+uint16_t beep_length_short = BEEP_LENGTH_SHORT;
+uint16_t beep_length_long = BEEP_LENGTH_LONG;
+uint16_t beep_length_err = BEEP_LENGTH_ERR;
+uint16_t stable_band_g = STABLE_BAND_G;
+uint16_t autocycle_tare_band_g = AUTOCYCLE_TARE_BAND_G;
+uint8_t topup_hysteresis_percent = TOPUP_HYSTERESIS_PERCENT;
+long limit_target_max_g = MAX_WEIGHT_SETPOINT;
+long limit_offset_max_g = MAX_WEIGHT_OFFSET;
 
 
 long current_weight_g = 13420;
@@ -125,9 +279,11 @@ bool p2_tara_offset_ok = true;
 
 long p0_target_g = DEFAULT_WEIGHT_TARGET_NO_PRESET;
 bool p0_target_ok = true;
+long p0_tara_offset_g = 0;         // ohne VE: Tara des erkannten Behälters, sonst 0
 
 long last_target_g = 0;
 long last_target_done_g = 0;
+uint32_t fill_count = 0;           // abgeschlossene Befüllungen seit dem Start
 long t_last_target_started = 0;
 long t_last_target_duration = 0;
 
@@ -143,6 +299,35 @@ bool use_keytones = true;
 bool use_endtone = true;
 int endtone_repetitions_done = 0;
 
+// Füll-Journal: abgebrochene Befüllung nach Spannungsausfall fortsetzen
+uint32_t t_resume_elapsed = 0;     // bereits vor dem Neustart verstrichene Füllzeit (ms)
+
+// Ganzwert-Eingabe: Sollwert / Tara-Versatz / Kalibriermasse als Ganzes drehen statt stellenweise
+bool use_direct_edit = false;
+
+// Auto-Zyklus: nach dem Befüllen Entnahme des vollen und Aufstellen eines leeren Behälters erkennen, dann neu starten
+bool use_autocycle = false;
+enum AutoCyclePhase : uint8_t {
+  AUTOCYCLE_OFF,              // Befüllung nicht regulär beendet (STOPP), kein automatischer Neustart
+  AUTOCYCLE_WAIT_REMOVAL,     // voller Behälter steht noch auf der Waage
+  AUTOCYCLE_WAIT_CONTAINER,   // Waage ist leer, warten auf leeren Behälter
+  AUTOCYCLE_CONFIRM,          // leerer Behälter erkannt, Start nach t_autocycle_confirm
+};
+AutoCyclePhase autocycle_phase = AUTOCYCLE_OFF;
+uint32_t t_autocycle_confirm_started = 0;
+
+// Nachfüllen: in 13 / 18 / 23 bleiben und das Ventil zwischen unterer Schwelle und Sollwert takten
+bool use_topup = false;
+bool topup_waiting = false;        // Sollwert erreicht, Ventil zu, warten auf untere Schwelle
+uint32_t topup_cycles = 0;         // abgeschlossene Nachfüll-Zyklen der laufenden Befüllung
+uint32_t t_topup_closed = 0;
+
+// Stillstandserkennung
+bool weight_stable = false;
+bool loadcell_warm = false;        // Einschwingen nach dem Start abgeschlossen
+long stable_reference_g = 0;
+uint32_t t_stable_since = 0;
+
 // LCD-Menü und Zustände
 bool redraw_screen = true;
 uint8_t state = 0;
@@ -154,372 +339,2188 @@ uint8_t sub_state = 0;
       Aber es funktioniert und ich will es nicht ändern.
  */
 
-// Status-Flag, ob der Ausgang aktiviert ist.
-bool output_enabled = true;
+// Status-Flag, ob der Ausgang aktiviert ist. Wird auch in der Knopf-ISR gelesen.
+volatile bool output_enabled = true;
+uint8_t output_channel = 0;          // zuletzt eingeschalteter Ausgang, siehe enableOutput()
+
+// Wird gesetzt, wenn der Knopf während einer aktiven Dosierung gedrückt und der Ausgang 
+// daraufhin direkt in der ISR abgeschaltet wurde. Verhindert ein erneutes Einschalten.
+volatile bool input_stop_latched = false;
 
 // Hardware aus Libraries
-HX711_ADC loadcell  (PIN_HX711_DAT, PIN_HX711_SCK);
+Hx711<PIN_HX711_DAT, PIN_HX711_SCK> loadcell;
 LCD_I2C   lcd       (0x27, 16, 2);
 
 // quick and dirty ;)
+const unsigned int pow10_table[5] PROGMEM = {1, 10, 100, 1000, 10000};
 unsigned int pow10(unsigned int exponent) {
-  static unsigned int pow10[10] = {1, 10, 100, 1000, 10000};
-  return pow10[exponent]; 
+  return pgm_read_word(&pow10_table[exponent]); 
+}
+
+/*  =============================
+      Kalibrierung
+    ============================= */
+
+// Kennlinie Rohwert (Mittelwert abzgl. Tara) -> Gramm, stückweise linear über bis zu CAL_POINTS_MAX
+// Kalibrierpunkte. Stützstelle 0 ist immer der Nullpunkt, 1..n sind die Kalibrierpunkte aufsteigend 
+// nach Rohwert. Nicht belegte Stützstellen stehen auf LONG_MAX, damit die Suche sie nie auswählt.
+// Ohne Kalibrierpunkte gilt eine Gerade durch den Nullpunkt mit dem Kalibrierungsfaktor.
+// Bei verpolter Wiegezelle (negativer Kalibrierungsfaktor) fällt der Rohwert mit der Masse, die
+// Stützstellen werden dann mit negiertem Rohwert geführt, damit Rohwert und Masse immer steigen.
+long cal_knot_raw[CAL_POINTS_MAX+1];
+long cal_knot_mass_g[CAL_POINTS_MAX+1];
+float cal_slope[CAL_POINTS_MAX];     // g pro Rohwert-Schritt ab Stützstelle k
+uint8_t cal_points_count = 0;
+bool cal_inverted = false;           // Rohwert fällt mit der Masse
+bool cal_point_rejected = false;     // letzter Kalibrierpunkt verworfen (Anzeige in 62)
+
+// Steigungen neu berechnen, oberhalb des letzten Punkts wird mit der letzten Steigung extrapoliert
+void calibrationRebuild() {
+  cal_knot_raw[0] = 0;
+  cal_knot_mass_g[0] = 0;
+  for (uint8_t k = cal_points_count + 1; k <= CAL_POINTS_MAX; k++) {
+    cal_knot_raw[k] = LONG_MAX;
+    cal_knot_mass_g[k] = 0;
+  }
+  cal_inverted = loadcell.getCalFactor() < 0;
+  if (cal_points_count == 0) cal_slope[0] = 1.0f / fabs(loadcell.getCalFactor());
+  for (uint8_t k = 0; k < cal_points_count; k++) {
+    cal_slope[k] = (float)(cal_knot_mass_g[k+1] - cal_knot_mass_g[k]) / (float)(cal_knot_raw[k+1] - cal_knot_raw[k]);
+  }
+  for (uint8_t k = cal_points_count > 0 ? cal_points_count : 1; k < CAL_POINTS_MAX; k++) {
+    cal_slope[k] = cal_slope[k-1];
+  }
+}
+
+// Kalibrierpunkt sortiert einfügen. Ein Punkt mit gleichem Rohwert wird ersetzt. Rohwert und
+// Masse müssen gegenüber beiden Nachbar-Stützstellen (auch dem Nullpunkt) streng steigen, sonst
+// entstünde eine negative oder unendliche Steigung: der Punkt wird dann verworfen (false).
+bool calibrationAddPoint(long raw, long mass_g) {
+  if (loadcell.getCalFactor() < 0) raw = -raw;
+  if (raw <= 0 || mass_g <= 0) return false;
+  uint8_t k = 1;
+  while (k <= cal_points_count && cal_knot_raw[k] < raw) k++;
+  bool replace = k <= cal_points_count && cal_knot_raw[k] == raw;
+  uint8_t above = replace ? k + 1 : k;
+  if (mass_g <= cal_knot_mass_g[k-1]) return false;
+  if (above <= cal_points_count && mass_g >= cal_knot_mass_g[above]) return false;
+  if (!replace) {
+    if (cal_points_count >= CAL_POINTS_MAX) return false;
+    for (uint8_t i = cal_points_count + 1; i > k; i--) {
+      cal_knot_raw[i] = cal_knot_raw[i-1];
+      cal_knot_mass_g[i] = cal_knot_mass_g[i-1];
+    }
+    cal_knot_raw[k] = raw;
+    cal_points_count++;
+  }
+  cal_knot_mass_g[k] = mass_g;
+  calibrationRebuild();
+  return true;
+}
+
+// Abschnitt zum Rohwert: feste Binärsuche über 8 Abschnitte (immer 3 Vergleiche)
+uint8_t calibrationSegment(long raw) {
+  uint8_t k = raw >= cal_knot_raw[4] ? 4 : 0;
+  k += raw >= cal_knot_raw[k+2] ? 2 : 0;
+  k += raw >= cal_knot_raw[k+1] ? 1 : 0;
+  return k;
+}
+
+// Umrechnung pro Messwert: Abschnitt suchen, dann linear
+long calibratedMass(long raw) {
+  if (cal_inverted) raw = -raw;
+  uint8_t k = calibrationSegment(raw);
+  return cal_knot_mass_g[k] + (long)((float)(raw - cal_knot_raw[k]) * cal_slope[k]);
 }
 
 // Einfache Prozedur für Software-Reset
 void(* reset_function) (void) = 0;
 
+typedef FastPin<PIN_OUTPUT> OutputPin;
+typedef FastPin<PIN_OUTPUT_2> Output2Pin;
+typedef FastPin<PIN_OUTPUT_3> Output3Pin;
+typedef FastPin<PIN_SW_1> Switch1Pin;
+typedef FastPin<PIN_SW_2> Switch2Pin;
+
+// alle Ausgänge aus, auch aus dem STOPP-Interrupt und vor dem C-Startup
+inline void outputsLow() __attribute__((always_inline));
+inline void outputsLow() {
+  OutputPin::low();
+  Output2Pin::low();
+  Output3Pin::low();
+}
+
 void disableOutput() {
-  digitalWrite(PIN_OUTPUT, LOW);
+  outputsLow();
   output_enabled = false;
   #ifdef SERIAL_ENABLED
-  Serial.println("Ausgang deaktiviert.");
+  Serial.println(txt(TXT_OUTPUT_OFF));
   #endif
 }
 
-void enableOutput() {
-  output_enabled = true;
-  digitalWrite(PIN_OUTPUT, HIGH);
+// channel: 0 = Hauptausgang, 1 / 2 = Ausgang 2 / 3 (Rezepte)
+void enableOutput(uint8_t channel = 0) {
+  // atomar, damit der STOPP-Interrupt nicht zwischen Flag und Pin dazwischenfunkt
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    output_enabled = true;
+    output_channel = channel;
+    switch (channel) {
+      case 1: { Output2Pin::high(); break; }
+      case 2: { Output3Pin::high(); break; }
+      default: { OutputPin::high(); break; }
+    }
+  }
   #ifdef SERIAL_ENABLED
-  Serial.println("Ausgang aktiviert.");
+  Serial.println(txt(TXT_OUTPUT_ON));
   #endif
 }
 
-// Einstellungs-Bitvektor aus den aktuell aktiven Einstellungen erstellen
-uint8_t getToggleSettingsFromState() {
-  uint8_t settings_bitvector = 0;
-  settings_bitvector = use_keytones ? settings_bitvector | 1 << SETTINGS_KEYTONE : settings_bitvector & ~ (1 << SETTINGS_KEYTONE);
-  settings_bitvector = use_endtone ? settings_bitvector | 1 << SETTINGS_ENDTONE : settings_bitvector & ~ (1 << SETTINGS_ENDTONE);
-  return settings_bitvector;
+
+/*  =============================
+      Rauschtest
+    ============================= */
+
+// Diagnose aus den Einstellungen (Zustand 32): NOISETEST_DURATION_MS lang werden die ungefilterten
+// 24-Bit-Rohwerte gesammelt. Mittelwert und Standardabweichung laufend nach Welford, relativ zum
+// ersten Messwert, damit float (24 Bit Mantisse) genau genug bleibt. Als Ausreißer zählt ein Wert,
+// der mehr als NOISETEST_SPIKE_SIGMA Standardabweichungen vom bisherigen Mittelwert abweicht.
+//
+// Vorschlag für das Mittelwert-Fenster: das kürzeste N, bei dem der gefilterte Wert durch Rauschen
+// allein nur mit der Wahrscheinlichkeit zu z um mehr als NOISETEST_MARGIN_G abweicht,
+// also z * sigma / sqrt(N) <= NOISETEST_MARGIN_G mit z = noisetest_z / 100 (Parameter "noise_z").
+// Die Wandlungsrate des HX711 ist per Pin RATE fest verdrahtet, gemessen wird daher mit der
+// eingebauten Rate (wird mit ausgegeben).
+#define NOISETEST_DURATION_MS 5000
+#define NOISETEST_SPIKE_SIGMA 4
+#define NOISETEST_SPIKE_MIN_SAMPLES 8
+#define NOISETEST_MARGIN_G (stable_band_g / 2.0f)
+
+struct NoiseStats {
+  long reference;          // erster Rohwert
+  uint16_t count;
+  float mean;              // relativ zu reference
+  float m2;                // Summe der quadrierten Abweichungen vom Mittelwert
+  long min_raw;
+  long max_raw;
+  uint16_t spikes;
+};
+
+NoiseStats noise;
+uint32_t t_noisetest_started = 0;
+uint16_t noisetest_z = DEFAULT_NOISETEST_Z;
+float noisetest_enob = 0;
+float noisetest_sd_g = 0;
+uint8_t noisetest_window = HX711_SAMPLES;    // vorgeschlagenes Fenster
+bool noisetest_window_ok = true;             // Vorgabe mit max. HX711_SAMPLES erreichbar
+
+void noiseTestBegin(uint32_t t) {
+  memset(&noise, 0, sizeof(noise));
+  t_noisetest_started = t;
 }
 
-// Aktive Einstellungen aus Einstellungs-Bitvektor übernehmen
-void setToggleSettingsFromBitvector(uint8_t settings_bitvector) {
-  use_keytones = (settings_bitvector & (1 << SETTINGS_KEYTONE)) >> SETTINGS_KEYTONE;
-  use_endtone = (settings_bitvector & (1 << SETTINGS_ENDTONE)) >> SETTINGS_ENDTONE;
+void noiseTestSample(long raw) {
+  if (noise.count == 0) {
+    noise.reference = raw;
+    noise.min_raw = raw;
+    noise.max_raw = raw;
+  }
+  float x = raw - noise.reference;
+  if (noise.count >= NOISETEST_SPIKE_MIN_SAMPLES
+   && fabs(x - noise.mean) > NOISETEST_SPIKE_SIGMA * sqrt(noise.m2 / (noise.count - 1))) noise.spikes++;
+  noise.count++;
+  float delta = x - noise.mean;
+  noise.mean += delta / noise.count;
+  noise.m2 += delta * (x - noise.mean);
+  if (raw < noise.min_raw) noise.min_raw = raw;
+  if (raw > noise.max_raw) noise.max_raw = raw;
 }
 
-void drawCurrentWeight(long* weigth, long* offset = nullptr) {
-  static long w = 0;
-  w = offset==nullptr ? *weigth : *weigth - *offset;
-  lcd.setCursor(1,0);
-  if (w < 0) {
-    lcd.print(F("-"));
-    w = 0 - w;
-  }
-  else lcd.print(F(" "));
-  if (w >= 65536) {
-    lcd.print(F("  "));
-    lcd.setCursor(5,0);
-    lcd.write(3);
-  } else {    
-    if (w / 10000 != 0) lcd.print(w / 10000); else lcd.write(' ');
-    lcd.print(w % 10000 / 1000);
-    lcd.setCursor(5,0);
-    lcd.print(w % 1000 / 100);
-  }  
-}
-
-void drawTragetWeight(long* target) {
-  lcd.setCursor(7,0);
-  // wenn man im Bearbeitungs-Modus ist, soll auch die führende 0 immer erscheinen!
-  if (*target / 10000 != 0 || state==15 || state == 20 || state==25) 
-    lcd.print(*target / 10000); 
-  else lcd.write(' ');
-  lcd.print(*target % 10000 / 1000);
-  lcd.setCursor(10,0);
-  lcd.print(*target % 1000 / 100);
-}
-
-void drawTaraOffsetValue(long* value) {
-  lcd.setCursor(11,1);
-  lcd.print(*value / 1000);
-  lcd.setCursor(13,1);
-  lcd.print(*value % 1000 / 100);
-  lcd.print(*value % 100 / 10);
+void noiseTestFinish(uint32_t t) {
+  float sd = noise.count > 1 ? sqrt(noise.m2 / (noise.count - 1)) : 0;
+  // effektive Auflösung: 24 Bit abzgl. der Bits, die das Rauschen (Std.-Abw. bzw. Spitze-Spitze) belegt
+  noisetest_enob = sd > 1 ? 24 - log(sd) / M_LN2 : 24;
+  // Umrechnung in g mit der Steigung des Kalibrier-Abschnitts, in dem die Messung lag
+  long raw_mean = noise.reference + (long)noise.mean - loadcell.getTareOffset();
+  if (cal_inverted) raw_mean = -raw_mean;
+  float slope = fabs(cal_slope[calibrationSegment(raw_mean)]);
+  noisetest_sd_g = isfinite(slope) ? sd * slope : 0;
+  float k = noisetest_z / 100.0f * noisetest_sd_g / NOISETEST_MARGIN_G;
+  float n = k * k;
+  noisetest_window_ok = n <= HX711_SAMPLES;
+  noisetest_window = !noisetest_window_ok ? HX711_SAMPLES : n <= 1 ? 1 : (uint8_t)ceil(n);
+
+  #ifdef SERIAL_ENABLED
+  long p2p = noise.max_raw - noise.min_raw;
+  Serial.print(txt(TXT_NOISE_RESULT_RATE));
+  Serial.print(noise.count);
+  Serial.print(txt(TXT_SEPARATOR));
+  Serial.println(noise.count * 1000.0f / (t - t_noisetest_started), 1);
+  Serial.print(txt(TXT_NOISE_RESULT_RAW));
+  Serial.print(noise.reference + (long)noise.mean);
+  Serial.print(txt(TXT_SEPARATOR));
+  Serial.print(sd, 1);
+  Serial.print(txt(TXT_SEPARATOR));
+  Serial.println(p2p);
+  Serial.print(txt(TXT_NOISE_RESULT_BITS));
+  Serial.print(noisetest_sd_g, 2);
+  Serial.print(txt(TXT_SEPARATOR));
+  Serial.print(noise.spikes);
+  Serial.print(txt(TXT_SEPARATOR));
+  Serial.print(noisetest_enob, 1);
+  Serial.print(txt(TXT_SEPARATOR));
+  Serial.println(p2p > 1 ? 24 - log(p2p) / M_LN2 : 24, 1);
+  Serial.print(txt(TXT_NOISE_RESULT_WINDOW));
+  Serial.print(noisetest_window);
+  if (!noisetest_window_ok) Serial.print(txt(TXT_NOISE_WINDOW_LIMIT));
+  Serial.println();
+  #else
+  (void)t;
+  #endif
 }
 
-void drawScreenForState(uint8_t targetState) {
-  lcd.clear();
-  lcd.setCursor(0,0);
-  lcd.noBlink();
-  switch (targetState) {
-    case 2: {
-      lcd.print(F("  FEHLER!!  :(  "));
-      lcd.setCursor(4,1);
-      lcd.write(0);
-      lcd.print(F(" RESET"));
-      break;
-    }
-    case 4: 
-    case 9: {
-      lcd.println(F("Waage entlasten!"));
-      lcd.print(F("(Tara)"));
-      lcd.setCursor(8,1);
-      lcd.write(0);
-      lcd.print(F(" weiter"));
-      break;
-    }
-    case 41: 
-    case 61: 
-    case 91: {
-      lcd.println(F(" Bitte warten!  "));
-      break;
-    }
-    case 5: {
-      lcd.println(F("Bek. Masse aufl."));
-      lcd.print(F("(Kal.)"));
-      lcd.setCursor(8,1);
-      lcd.write(0);
-      lcd.print(F(" weiter"));
-      break;
-    }
-    case 6: {
-      lcd.print(F("Bekannte Masse:"));
-      lcd.setCursor(1,1);
-      lcd.write(0);
-      break;
-    }
-    case 7:
-    case 10: {
-      if (targetState == 7) lcd.print(F("Kal. speichern?"));
-      else lcd.print(F("Tara speichern?"));
-      lcd.setCursor(3,1);
-      lcd.print(F("Ja     Nein"));
-      break;
-    }
-    case 12:
-    case 17: {
-      lcd.print(F("  --.-/--.-  VE"));
-      if (targetState==12) lcd.write('1');
-      else lcd.write('2');
-      lcd.setCursor(0,1);
-      lcd.print(F("  START  TV-.--"));
-      redraw_screen = true;
-      break;
-    }
-    case 22:
-    case 25: {
-      lcd.print(F("  --.-/--.-  VE"));
-      lcd.write(2);
-      lcd.setCursor(0,1);
-      lcd.print(F("  START   Einst."));
-      redraw_screen = true;
-      break;
-    }
-    case 13:
-    case 18:
-    case 23: {
-      lcd.print(F("  --.-/--.-  VE"));
-      if (targetState==23) lcd.write(2);
-      else if (targetState==13) lcd.write('1');
-      else lcd.write('2');
-      lcd.setCursor(0,1);
-      lcd.print(F("  aktiv   STOPP!"));
-      lcd.setCursor(9,1);
-      lcd.write(0);
-      redraw_screen = true;
-      break;
-    }
-    case 14:
-    case 19:
-    case 24: {
-      long secs = t_last_target_duration / 1000;
-      lcd.write(1);
-      lcd.print(F(" --.-/--.-  VE"));
-      if (targetState==24) lcd.write(2);
-      else if (targetState==14) lcd.write('1');
-      else lcd.write('2');
-      drawCurrentWeight(&last_target_done_g);
-      drawTragetWeight(&last_target_g);
-      lcd.setCursor(0,1);
-      lcd.print(F("--min--s  fertig"));
-      lcd.setCursor(0,1);
-      if (secs > 5999) {
-        lcd.write(' ');
-        lcd.write(3);
-      } else {
-        if (secs/600 != 0) lcd.print(secs/600); else lcd.print(' ');
-        lcd.print(secs % 600 / 60);
-        lcd.setCursor(5,1);
-        if (secs % 60 / 10 != 0) lcd.print(secs % 60 / 10); else lcd.print(' ');
-        lcd.print(secs % 10);
-      }      
-      lcd.setCursor(9,1);
-      lcd.write(0);
-      redraw_screen = true;
+
+/*  =============================
+      Füll-Journal
+    ============================= */
+
+// Geht während einer Befüllung (Zustände 13/18/23) die Versorgung verloren, steht nach dem Neustart
+// im EEPROM, was befüllt wurde. Geschrieben wird beim Start und in groben Schritten (je 1/4 des
+// Sollwerts, frühestens JOURNAL_INTERVAL_MS nach dem letzten Eintrag und nicht mehr im letzten
+// Viertel, damit die EEPROM-Schreibzeit nicht kurz vor dem Abschalten anfällt). Nach regulärem
+// Ende oder Abbruch wird der Eintrag als abgeschlossen markiert. Erneutes Öffnen beim Nachfüllen
+// wird nicht mehr eingetragen.
+//
+// Gegen Verschleiß der EEPROM-Zellen (ca. 100.000 Schreibzyklen) geht jede Befüllung in den
+// nächsten von JOURNAL_SLOTS Einträgen. Statt eines festen Gültig-Bytes trägt jeder Eintrag eine
+// laufende Nummer, der neueste ist der letzte vor der ersten Lücke in der Folge. Die Nummer wird
+// als Letztes geschrieben, ein halb geschriebener Eintrag gilt also noch nicht.
+#define JOURNAL_SLOTS 4
+#define JOURNAL_STEPS 4
+#define JOURNAL_INTERVAL_MS 10000
+#define JOURNAL_CLOSED 0xFF
+
+struct FillJournal {
+  uint8_t seq;             // laufende Nummer
+  uint8_t preset;          // 1 / 2 = VE1 / VE2, 0 = ohne Voreinstellung, JOURNAL_CLOSED = abgeschlossen
+  uint16_t elapsed_s;      // Füllzeit bis zum letzten Eintrag
+  int32_t target_g;
+  int32_t offset_g;
+  int32_t delivered_g;     // netto befüllt bis zum letzten Eintrag
+};
+static_assert(addr_fill_journal + JOURNAL_SLOTS * sizeof(FillJournal) <= addr_curves, "Journal ueberschreitet seinen EEPROM-Bereich");
+
+FillJournal journal;               // neuester Eintrag
+uint8_t journal_slot = 0;          // dessen Platz im Ring
+bool journal_active = false;
+long journal_next_g = 0;
+uint32_t t_journal_written = 0;
+
+// Reset-Ursache, wird vor der Initialisierung der Variablen gesichert (sofern der Bootloader
+// MCUSR nicht schon gelöscht hat)
+uint8_t reset_flags __attribute__((section(".noinit")));
+
+// Direkt nach dem Reset, noch vor dem C-Startup: Ausgang aktiv auf low ziehen. Nach einem
+// Brown-out-Reset (BOD-Fuse, beim Nano 2,7 V) bleibt das Ventil so sicher geschlossen, auch
+// wenn die Versorgung beim Wiederanlauf noch schwankt.
+void outputOffEarly() __attribute__((naked, used, section(".init3")));
+void outputOffEarly() {
+  outputsLow();
+  OutputPin::output();
+  Output2Pin::output();
+  Output3Pin::output();
+  reset_flags = MCUSR;
+  MCUSR = 0;
+}
+
+uint16_t journalAddr(uint8_t slot) {
+  return addr_fill_journal + slot * sizeof(FillJournal);
+}
+
+// neuen Eintrag im nächsten Platz des Rings anlegen, die laufende Nummer zuletzt
+void journalStart(uint8_t preset, long target_g, long offset_g, uint32_t elapsed_ms) {
+  journal_slot = (journal_slot + 1) % JOURNAL_SLOTS;
+  journal.seq++;
+  journal.preset = preset;
+  journal.target_g = target_g;
+  journal.offset_g = offset_g;
+  journal.delivered_g = 0;
+  journal.elapsed_s = elapsed_ms / 1000;
+  eepromQueueWrite(journalAddr(journal_slot) + 1, (uint8_t*)&journal + 1, sizeof(FillJournal) - 1);
+  eepromQueuePut(journalAddr(journal_slot), journal.seq);
+  journal_active = true;
+  journal_next_g = target_g / JOURNAL_STEPS;
+  t_journal_written = millis();
+}
+
+// nur Fortschritt schreiben, unveränderte Bytes überspringt die Warteschlange
+void journalProgress(long delivered_g, uint32_t elapsed_ms) {
+  journal.delivered_g = delivered_g;
+  journal.elapsed_s = elapsed_ms / 1000;
+  eepromQueuePut(journalAddr(journal_slot) + offsetof(FillJournal, delivered_g), journal.delivered_g);
+  eepromQueuePut(journalAddr(journal_slot) + offsetof(FillJournal, elapsed_s), journal.elapsed_s);
+  t_journal_written = millis();
+}
+
+void journalClear() {
+  journal_active = false;
+  if (journal.preset == JOURNAL_CLOSED) return;
+  journal.preset = JOURNAL_CLOSED;
+  eepromQueuePut(journalAddr(journal_slot) + offsetof(FillJournal, preset), journal.preset);
+}
+
+// neuesten Eintrag suchen und laden (auch wenn er abgeschlossen ist, für die laufende Nummer)
+bool journalLoad() {
+  journal_slot = JOURNAL_SLOTS - 1;
+  uint8_t seq = EEPROM.read(journalAddr(0));
+  for (uint8_t slot = 1; slot < JOURNAL_SLOTS; slot++) {
+    uint8_t next = EEPROM.read(journalAddr(slot));
+    if (next != (uint8_t)(seq + 1)) {
+      journal_slot = slot - 1;
       break;
     }
-    case 26: {
-      lcd.setCursor(1,0);
-      lcd.write(4);
-      lcd.setCursor(7,0);
-      lcd.print(F("TT    ET"));
-      lcd.setCursor(1,1);
-      lcd.print(F("TARA  KALI  RST"));
-      break;
+    seq = next;
+  }
+  EEPROM.get(journalAddr(journal_slot), journal);
+  return journal.preset <= 2
+      && journal.target_g >= MIN_WEIGHT_SETPOINT && journal.target_g <= MAX_WEIGHT_SETPOINT;
+}
+
+
+/*  =============================
+      Füllkurven
+    ============================= */
+
+// Die letzten CURVE_SLOTS Befüllungen werden als Verlauf des Nettogewichts im EEPROM abgelegt,
+// Export über die serielle Schnittstelle mit "curves". Abgetastet wird alle curve_interval_s
+// Sekunden in Einheiten von CURVE_UNIT_G. Gespeichert wird je Abtastwert nur die Differenz zum
+// vorherigen, zig-zag-kodiert (kleine negative Werte bleiben klein) als Varint mit 7 Bit je Byte,
+// Bit 7 = es folgt noch ein Byte. Bis ca. 6 kg/min (bei 6 s und 10 g) ist das 1 Byte je
+// Abtastwert, eine Befüllung von 10 min passt also in einen Slot.
+//
+// Die Daten werden während der Befüllung angehängt, der Kopf erst am Ende geschrieben (magic
+// zuletzt, danach bleibt es unverändert und wird nicht erneut geschrieben). Der alte Kopf bleibt
+// bis dahin stehen, die Prüfsumme über die Datenbytes passt dann nicht mehr: eine durch
+// Spannungsausfall unterbrochene Kurve fehlt beim Export einfach. Jedes Datenbyte wird nur
+// einmal je CURVE_SLOTS Befüllungen geschrieben. Erneutes Öffnen beim Nachfüllen wird nicht
+// aufgezeichnet.
+#define CURVE_SLOTS 3
+#define CURVE_SLOT_SIZE 112
+#define CURVE_UNIT_G 10
+#define CURVE_INTERVAL_DEFAULT_S 6
+#define CURVE_INTERVAL_MAX_S 60
+
+#define CURVE_FLAG_ABORTED 1      // abgebrochen (STOPP, Schalter, ...)
+#define CURVE_FLAG_TRUNCATED 2    // Slot voll, der Rest der Befüllung fehlt
+
+struct CurveHeader {
+  uint8_t magic;           // 169 = gültig
+  uint8_t seq;             // fortlaufend, die (mod 256) höchste ist die neueste
+  uint8_t preset;          // 1 / 2 = VE1 / VE2, 0 = ohne Voreinstellung
+  uint8_t interval_s;
+  uint8_t len;             // belegte Datenbytes
+  uint8_t flags;
+  uint8_t check;           // Summe der Datenbytes (mod 256)
+  long target_g;
+};
+
+#define CURVE_DATA_SIZE (CURVE_SLOT_SIZE - sizeof(CurveHeader))
+static_assert(addr_curves + CURVE_SLOTS * CURVE_SLOT_SIZE <= E2END + 1, "Fuellkurven passen nicht ins EEPROM");
+
+CurveHeader curve;                 // Kopf der laufenden bzw. letzten Aufzeichnung
+bool curve_recording = false;
+uint8_t curve_slot = 0;            // Slot der laufenden bzw. nächsten Aufzeichnung
+uint8_t curve_interval_s = CURVE_INTERVAL_DEFAULT_S;
+long curve_last_units = 0;
+uint32_t t_curve_next = 0;
+
+uint16_t curveSlotAddr(uint8_t slot) {
+  return addr_curves + slot * CURVE_SLOT_SIZE;
+}
+
+// nur in setup(): Intervall laden und nach dem neuesten gültigen Slot weitermachen
+void curveLoad() {
+  curve_interval_s = EEPROM.read(addr_curve_interval);
+  if (curve_interval_s < 1 || curve_interval_s > CURVE_INTERVAL_MAX_S) curve_interval_s = CURVE_INTERVAL_DEFAULT_S;
+  int8_t newest = -1;
+  for (uint8_t slot = 0; slot < CURVE_SLOTS; slot++) {
+    CurveHeader header;
+    EEPROM.get(curveSlotAddr(slot), header);
+    if (header.magic != 169) continue;
+    if (newest < 0 || (int8_t)(header.seq - curve.seq) > 0) {
+      newest = slot;
+      curve.seq = header.seq;
     }
-    case 27: {
-      lcd.print(F(" ZURUECKSETZEN? "));
-      lcd.setCursor(0,1);
-      lcd.print(F("Sicher?  nee  ja"));
-      break;
+  }
+  curve_slot = newest < 0 ? 0 : (newest + 1) % CURVE_SLOTS;
+}
+
+void curveStart(uint32_t t, uint8_t preset, long target_g) {
+  curve.magic = 169;
+  curve.seq++;
+  curve.check = 0;
+  curve.preset = preset;
+  curve.interval_s = curve_interval_s;
+  curve.len = 0;
+  curve.flags = 0;
+  curve.target_g = target_g;
+  curve_last_units = 0;
+  t_curve_next = t;
+  curve_recording = true;
+}
+
+void curveSample(uint32_t t, long net_g) {
+  if (!curve_recording || (curve.flags & CURVE_FLAG_TRUNCATED) || (int32_t)(t - t_curve_next) < 0) return;
+  t_curve_next += curve.interval_s * 1000UL;
+  long units = net_g / CURVE_UNIT_G;
+  long delta = units - curve_last_units;
+  // zig-zag: 0, -1, 1, -2, 2 ... -> 0, 1, 2, 3, 4 ...
+  uint32_t zigzag = ((uint32_t)delta << 1) ^ (uint32_t)(delta >> 31);
+  uint8_t bytes[5];
+  uint8_t count = 0;
+  do {
+    bytes[count] = zigzag & 0x7F;
+    zigzag >>= 7;
+    if (zigzag) bytes[count] |= 0x80;
+    count++;
+  } while (zigzag);
+  if (curve.len + count > CURVE_DATA_SIZE) {
+    curve.flags |= CURVE_FLAG_TRUNCATED;
+    return;
+  }
+  eepromQueueWrite(curveSlotAddr(curve_slot) + sizeof(CurveHeader) + curve.len, bytes, count);
+  for (uint8_t i = 0; i < count; i++) curve.check += bytes[i];
+  curve.len += count;
+  curve_last_units = units;
+}
+
+void curveFinish(bool aborted) {
+  if (!curve_recording) return;
+  curve_recording = false;
+  if (aborted) curve.flags |= CURVE_FLAG_ABORTED;
+  uint16_t addr = curveSlotAddr(curve_slot);
+  eepromQueueWrite(addr + 1, (uint8_t*)&curve + 1, sizeof(CurveHeader) - 1);
+  eepromQueuePut(addr, curve.magic);
+  curve_slot = (curve_slot + 1) % CURVE_SLOTS;
+}
+
+// Alle gespeicherten Kurven, älteste zuerst, als "Sekunden;Gramm" ausgeben
+void curvesExport() {
+  #ifdef SERIAL_ENABLED
+  // das EEPROM darf erst gelesen werden, wenn die Schreib-Warteschlange leer ist
+  while (eepromQueueBusy());
+  bool found = false;
+  for (uint8_t i = 0; i < CURVE_SLOTS; i++) {
+    uint16_t addr = curveSlotAddr((curve_slot + i) % CURVE_SLOTS);
+    CurveHeader header;
+    EEPROM.get(addr, header);
+    if (header.magic != 169 || header.len > CURVE_DATA_SIZE) continue;
+    uint8_t check = 0;
+    for (uint8_t k = 0; k < header.len; k++) check += EEPROM.read(addr + sizeof(CurveHeader) + k);
+    if (check != header.check) continue;
+    found = true;
+    Serial.print(txt(TXT_CURVE_HEADER));
+    Serial.print(header.seq);
+    Serial.print(txt(TXT_SEPARATOR));
+    Serial.print(header.preset);
+    Serial.print(txt(TXT_SEPARATOR));
+    Serial.print(header.target_g);
+    Serial.print(txt(TXT_SEPARATOR));
+    Serial.print(header.interval_s);
+    Serial.print(txt(TXT_SEPARATOR));
+    Serial.println(header.flags);
+    Serial.println(txt(TXT_CURVE_COLUMNS));
+    long units = 0;
+    uint32_t zigzag = 0;
+    uint8_t shift = 0;
+    uint16_t t_s = 0;
+    for (uint8_t k = 0; k < header.len; k++) {
+      uint8_t b = EEPROM.read(addr + sizeof(CurveHeader) + k);
+      zigzag |= (uint32_t)(b & 0x7F) << shift;
+      shift += 7;
+      if (b & 0x80) continue;
+      units += (long)((zigzag >> 1) ^ (0 - (zigzag & 1)));
+      Serial.print(t_s);
+      Serial.print(';');
+      Serial.println(units * CURVE_UNIT_G);
+      t_s += header.interval_s;
+      zigzag = 0;
+      shift = 0;
     }
   }
-  redraw_screen = true;
+  if (!found) Serial.println(txt(TXT_CURVE_NONE));
+  #endif
 }
 
-void stateTransition(uint8_t targetState, uint8_t targetSubState = 0) {
-  state = targetState;
-  sub_state = targetSubState;
+/*  =============================
+      Aufzeichnung am Abschaltpunkt
+    ============================= */
+
+// Wie ein Oszilloskop mit Trigger: während der Befüllung laufen die Rohwerte des HX711 mit dem
+// Zeitabstand zum vorherigen Messwert in einen Ringpuffer. Erreicht das Gewicht in 13 / 18 / 23
+// den Sollwert, wird der Zeitpunkt des Schließens markiert, noch capture_post Messwerte
+// aufgenommen und der Puffer dann eingefroren. Erneutes Öffnen beim Nachfüllen löst nicht aus.
+// Ins EEPROM (stückweise, Kopf mit magic zuletzt) wird die eingefrorene Aufzeichnung nur mit
+// "capture save" oder automatisch höchstens alle capture_save_min Minuten geschrieben (0 = nur
+// auf Befehl), sonst bliebe bei jeder Befüllung der ganze Bereich neu zu schreiben. Ausgabe mit
+// "capture" als "ms;Rohwert;g", die Zeit relativ zum Schließen: die eingefrorene Aufzeichnung
+// aus dem RAM, sonst die zuletzt gespeicherte.
+#define CAPTURE_SAMPLES 32
+#define CAPTURE_CHUNK 8                // Messwerte je Schreibvorgang ins EEPROM
+
+struct CaptureSample {
+  uint32_t raw : 24;                   // Rohwert HX711 (Offset-Binär)
+  uint32_t dt_ms : 8;                  // Abstand zum vorherigen Messwert, max. 255 ms
+};
 
+struct CaptureHeader {
+  uint8_t magic;                       // 169 = gültig
+  uint8_t preset;
+  uint8_t count;                       // Anzahl Messwerte
+  uint8_t edge;                        // Index des ersten Messwerts nach dem Schließen
+  uint8_t edge_dt_ms;                  // Schließen nach dem letzten Messwert davor (ms)
+  long target_g;
+  long tare_offset;                    // Rohwert, zum Umrechnen in g
+};
+
+static_assert(addr_capture + sizeof(CaptureHeader) + CAPTURE_SAMPLES * sizeof(CaptureSample) <= addr_curves,
+              "Aufzeichnung überschreitet ihren EEPROM-Bereich");
+
+enum CapturePhase : uint8_t {
+  CAPTURE_IDLE,                        // leer bzw. gespeichert, wartet auf die nächste Befüllung
+  CAPTURE_ARMED,                       // Ringpuffer läuft, wartet auf das Schließen
+  CAPTURE_POST,                        // Messwerte nach dem Schließen
+  CAPTURE_FROZEN,                      // eingefroren, noch nicht gespeichert
+  CAPTURE_SAVING,                      // eingefroren, wird ins EEPROM geschrieben
+};
+
+CaptureSample capture_ring[CAPTURE_SAMPLES];
+CaptureHeader capture_header;
+CapturePhase capture_phase = CAPTURE_IDLE;
+uint8_t capture_post = DEFAULT_CAPTURE_POST;
+uint8_t capture_head = 0;              // nächster Platz im Ringpuffer
+uint8_t capture_count = 0;
+uint8_t capture_left = 0;              // POST: fehlende Messwerte, SAVING: noch zu speichernde
+uint32_t t_capture_last = 0;           // Zeit des letzten Messwerts
+uint16_t capture_save_min = DEFAULT_CAPTURE_SAVE_MIN;
+uint32_t t_capture_saved = 0;
+bool capture_saved = false;            // seit dem Start schon einmal gespeichert
+
+// neue Befüllung beginnt (auch Fortsetzen, nicht erneutes Öffnen beim Nachfüllen): Ringpuffer
+// neu starten. Ein laufendes Speichern wird nicht abgebrochen, diese Befüllung fehlt dann.
+void captureArm() {
+  if (capture_post == 0 || capture_phase == CAPTURE_SAVING) return;
+  capture_phase = CAPTURE_ARMED;
+  capture_count = 0;
+  capture_header.count = 0;
+}
+
+// eingefrorene Aufzeichnung ins EEPROM schreiben, alte Aufzeichnung vorher ungültig machen
+bool captureSave() {
+  if (capture_phase != CAPTURE_FROZEN) return false;
+  eepromQueuePut(addr_capture, (uint8_t)0);
+  capture_left = capture_count;
+  capture_phase = CAPTURE_SAVING;
+  return true;
+}
+
+// i-ter Messwert der Aufzeichnung (ältester zuerst) aus dem Ringpuffer bzw. dem EEPROM
+CaptureSample captureAt(uint8_t i, bool ram) {
+  CaptureSample sample;
+  if (ram) sample = capture_ring[(capture_head + CAPTURE_SAMPLES - capture_count + i) % CAPTURE_SAMPLES];
+  else EEPROM.get(addr_capture + sizeof(CaptureHeader) + i * sizeof(CaptureSample), sample);
+  return sample;
+}
+
+// direkt nach disableOutput() am Sollwert. t_off wird vor disableOutput() gelesen, dessen
+// serielle Ausgabe sonst mit in die Zeit bis zur Abschaltflanke fiele.
+void captureTrigger(uint8_t preset, long target_g, uint32_t t_off) {
+  if (capture_phase != CAPTURE_ARMED || capture_post == 0) return;
+  capture_header.preset = preset;
+  capture_header.target_g = target_g;
+  capture_header.tare_offset = loadcell.getTareOffset();
+  uint32_t edge_dt = t_off - t_capture_last;
+  capture_header.edge_dt_ms = edge_dt > 255 ? 255 : edge_dt;
+  // davor bleiben so viele Messwerte, wie neben den folgenden in den Puffer passen
+  capture_header.edge = capture_count < CAPTURE_SAMPLES - capture_post ? capture_count : CAPTURE_SAMPLES - capture_post;
+  capture_left = capture_post;
+  capture_phase = CAPTURE_POST;
+}
+
+// nächstes Stück in Reihenfolge der Aufnahme (ältester Messwert zuerst) ins EEPROM
+void captureSaveChunk() {
+  CaptureSample chunk[CAPTURE_CHUNK];
+  uint8_t first = capture_count - capture_left;
+  uint8_t n = capture_left < CAPTURE_CHUNK ? capture_left : CAPTURE_CHUNK;
+  for (uint8_t i = 0; i < n; i++) chunk[i] = captureAt(first + i, true);
+  eepromQueueWrite(addr_capture + sizeof(CaptureHeader) + first * sizeof(CaptureSample), chunk, n * sizeof(CaptureSample));
+  capture_left -= n;
+  if (capture_left > 0) return;
+  capture_header.magic = 169;
+  eepromQueueWrite(addr_capture + 1, (uint8_t*)&capture_header + 1, sizeof(CaptureHeader) - 1);
+  eepromQueuePut(addr_capture, capture_header.magic);
+  capture_phase = CAPTURE_IDLE;
+  capture_saved = true;
+  t_capture_saved = millis();
   #ifdef SERIAL_ENABLED
-  Serial.print("State transition to ");
-  Serial.println(state);
+  Serial.print(txt(TXT_CAPTURE_SAVED));
+  Serial.println(capture_header.count);
   #endif
+}
 
-  switch (targetState) {
-    case 2: {
-      tone(PIN_BEEP, BEEP_FREQ_ERR, BEEP_LENGTH_ERR);
-    }
-    case 4:
-    case 5:
-    case 6:
-    case 7:
-    case 9:
-    case 10:
-    case 12:
-    case 13:
-    case 14:
-    case 17:
-    case 18:
-    case 19:
-    case 22:
-    case 23:
-    case 24:
-    case 26:
-    case 27:
-    case 41:
-    case 61:
-    case 91: {
-      drawScreenForState(targetState);
-      break;
-    }
-    case 15:
-    case 16:
-    case 20:
-    case 21: {
-      redraw_screen = true;
+// bei jedem gültigen Messwert
+void captureSample(long raw, uint32_t t) {
+  switch (capture_phase) {
+    case CAPTURE_ARMED:
+    case CAPTURE_POST: {
+      uint32_t dt = t - t_capture_last;
+      capture_ring[capture_head].raw = raw;
+      capture_ring[capture_head].dt_ms = dt > 255 ? 255 : dt;
+      capture_head = (capture_head + 1) % CAPTURE_SAMPLES;
+      if (capture_count < CAPTURE_SAMPLES) capture_count++;
+      t_capture_last = t;
+      if (capture_phase == CAPTURE_ARMED || --capture_left > 0) break;
+      // Puffer einfrieren, automatisch speichern nur nach Ablauf der Mindestzeit
+      capture_header.count = capture_count;
+      capture_phase = CAPTURE_FROZEN;
+      if (capture_save_min > 0 && (!capture_saved || t - t_capture_saved >= capture_save_min * 60000UL)) captureSave();
       break;
     }
-    case 25: {
-      p0_target_ok = true;
-      redraw_screen = true;
-      //drawScreenForState(25);
+    case CAPTURE_SAVING: {
+      // ein Stück je Messwert, damit die Warteschlange nicht voll läuft
+      if (!eepromQueueBusy()) captureSaveChunk();
       break;
     }
+    default: break;
   }
 }
 
-void onTurn(bool left = false) {
-  static bool beep;
-  beep = true;
-  redraw_screen = true;
+// Letzte Aufzeichnung ausgeben, Zeit relativ zum Schließen
+void captureExport() {
+  #ifdef SERIAL_ENABLED
+  // eingefroren im RAM (auch während des Speicherns), sonst aus dem EEPROM
+  bool ram = capture_header.count > 0;
+  CaptureHeader header = capture_header;
+  if (!ram) {
+    // das EEPROM darf erst gelesen werden, wenn die Schreib-Warteschlange leer ist
+    while (eepromQueueBusy());
+    EEPROM.get(addr_capture, header);
+  }
+  if ((!ram && header.magic != 169) || header.count > CAPTURE_SAMPLES || header.edge > header.count) {
+    Serial.println(txt(TXT_CAPTURE_NONE));
+    return;
+  }
+  Serial.print(txt(TXT_CAPTURE_HEADER));
+  Serial.print(header.preset);
+  Serial.print(txt(TXT_SEPARATOR));
+  Serial.print(header.target_g);
+  Serial.print(txt(TXT_SEPARATOR));
+  Serial.print(header.count);
+  Serial.print(txt(TXT_SEPARATOR));
+  Serial.println(header.edge);
+  if (capture_phase == CAPTURE_FROZEN) Serial.println(txt(TXT_CAPTURE_UNSAVED));
+  Serial.println(txt(TXT_CAPTURE_COLUMNS));
+  // Zeit des Schließens ab dem ersten Messwert
+  long t_edge = 0;
+  for (uint8_t i = 1; i < header.edge; i++) t_edge += captureAt(i, ram).dt_ms;
+  t_edge += header.edge_dt_ms;
+  long t_ms = 0;
+  for (uint8_t i = 0; i < header.count; i++) {
+    CaptureSample sample = captureAt(i, ram);
+    if (i > 0) t_ms += sample.dt_ms;
+    if (i == header.edge) Serial.println(txt(TXT_CAPTURE_EDGE));
+    Serial.print(t_ms - t_edge);
+    Serial.print(';');
+    Serial.print((long)sample.raw);
+    Serial.print(';');
+    Serial.println(calibratedMass((long)sample.raw - header.tare_offset));
+  }
+  #endif
+}
 
-  switch (state) {
-    case 6: {
-      if (sub_state < 4) {
-        if (left) {
-          cal_known_mass_g -= pow10(4-sub_state);
-          if (cal_known_mass_g < MIN_WEIGHT_CALIB) cal_known_mass_g = MIN_WEIGHT_CALIB;
-        } else {
-          cal_known_mass_g += pow10(4-sub_state);
-          if (cal_known_mass_g > MAX_WEIGHT_CALIB) cal_known_mass_g = MAX_WEIGHT_CALIB;
-        }
-      } 
-      else cal_known_mass_ok = !cal_known_mass_ok;
-      break;
-    }
-    case 7: 
-    case 10:
-    case 27: {
-      sub_state = (sub_state+1) % 2;
-      break;
-    }
-    case 12:
-    case 17:
-    case 22: {
-      sub_state = left ? (sub_state+2) % 3 : (sub_state+1) % 3;
-      break;
-    }
-    case 15: {
-      if (sub_state < 3) {
-        if (left) {
-          p1_target_g -= pow10(4-sub_state);
-          if (p1_target_g < MIN_WEIGHT_SETPOINT) p1_target_g = MIN_WEIGHT_SETPOINT;
-        } else {
-          p1_target_g += pow10(4-sub_state);
-          if (p1_target_g > MAX_WEIGHT_SETPOINT) p1_target_g = MAX_WEIGHT_SETPOINT;
-        }
-      } 
-      else p1_target_ok = !p1_target_ok;
-      break;
+/*  =============================
+      Notbetrieb ohne Wiegezelle
+    ============================= */
+
+// Liefert die Wiegezelle keine Messwerte mehr, geht es bei eingeschaltetem Notbetrieb statt in
+// den Fehlerzustand 2 in Zustand 37. Dort lässt sich eine zeitgesteuerte Befüllung (38) starten.
+// Die Füllrate jeder VE wird aus den regulär beendeten Befüllungen gelernt (gleitender
+// Mittelwert), gefüllt wird vorsichtshalber nur degraded_percent % des Sollwerts, abzüglich der
+// vor dem Ausfall schon gefüllten Menge, und höchstens t_degraded_max_s. Sobald wieder
+// Messwerte kommen, endet der Notbetrieb über Zustand 11 und es kann normal weitergefüllt werden.
+
+#define FLOW_PRESETS 3                 // ohne VE, VE 1, VE 2
+#define FLOW_MIN_FILLS 3               // erst ab so vielen gelernten Befüllungen ist Notbetrieb möglich
+#define FLOW_SMOOTHING 4               // neue Messung geht mit 1/FLOW_SMOOTHING ein
+#define FLOW_MIN_DURATION_MS 2000      // kürzere Befüllungen sind als Messung zu ungenau
+
+struct FlowRate {
+  uint16_t dg_per_s;                   // Füllrate in 0,1 g/s
+  uint8_t fills;                       // Anzahl gelernter Befüllungen (max. 255)
+};
+
+FlowRate flow_rates[FLOW_PRESETS];
+long fill_start_net_g = 0;             // netto beim Öffnen des Ventils
+bool fill_learnable = false;           // Befüllung ohne Fortsetzen nach Neustart, taugt als Messung
+
+bool use_degraded = false;
+uint8_t degraded_percent = DEFAULT_DEGRADED_PERCENT;
+uint16_t t_degraded_max_s = DEFAULT_T_DEGRADED_MAX;
+uint8_t degraded_preset = 0;
+long degraded_base_g = 0;              // schon gefüllt (vor dem Ausfall bzw. vor einem STOPP)
+long degraded_amount_g = 0;            // geplante Menge der zeitgesteuerten Befüllung
+uint32_t t_degraded_fill = 0;          // daraus berechnete Füllzeit (ms)
+uint32_t t_degraded_started = 0;
+
+// nur in setup()
+void flowLoad() {
+  if (EEPROM.read(addr_flow_saved_flag) == 169) EEPROM.get(addr_flow_rates, flow_rates);
+  else memset(flow_rates, 0, sizeof(flow_rates));
+}
+
+// Regulär beendete Befüllung: Füllrate der VE nachführen und speichern
+void flowLearn(uint8_t preset, long delivered_g, uint32_t duration_ms) {
+  if (!fill_learnable || delivered_g <= 0 || duration_ms < FLOW_MIN_DURATION_MS) return;
+  float rate = (float)delivered_g * 10000.0f / duration_ms;
+  if (rate >= 65535.0f) return;
+  FlowRate& f = flow_rates[preset];
+  if (f.fills == 0) f.dg_per_s = rate;
+  else f.dg_per_s += ((long)rate - f.dg_per_s) / FLOW_SMOOTHING;
+  if (f.fills < 255) f.fills++;
+  eepromQueuePut(addr_flow_rates + preset * sizeof(FlowRate), f);
+  eepromQueuePut(addr_flow_saved_flag, (uint8_t)169);
+}
+
+void flowPrint() {
+  #ifdef SERIAL_ENABLED
+  for (uint8_t i = 0; i < FLOW_PRESETS; i++) {
+    Serial.print(txt(TXT_FLOW_LIST));
+    Serial.print(i);
+    Serial.print(txt(TXT_SEPARATOR));
+    Serial.print(flow_rates[i].dg_per_s / 10.0f, 1);
+    Serial.print(txt(TXT_SEPARATOR));
+    Serial.println(flow_rates[i].fills);
+  }
+  #endif
+}
+
+long presetTarget(uint8_t preset) {
+  switch (preset) {
+    case 1: return p1_target_g;
+    case 2: return p2_target_g;
+    default: return p0_target_g;
+  }
+}
+
+bool degradedAvailable(uint8_t preset) {
+  return use_degraded && flow_rates[preset].fills >= FLOW_MIN_FILLS && flow_rates[preset].dg_per_s > 0;
+}
+
+// Menge und Füllzeit der nächsten zeitgesteuerten Befüllung berechnen
+void degradedPrepare(uint8_t preset, long delivered_g) {
+  degraded_preset = preset;
+  degraded_base_g = delivered_g;
+  float dg_per_s = flow_rates[preset].dg_per_s;
+  degraded_amount_g = presetTarget(preset) * degraded_percent / 100 - delivered_g;
+  if (degraded_amount_g < 0) degraded_amount_g = 0;
+  float t_fill = degraded_amount_g * 10000.0f / dg_per_s;
+  if (t_fill > t_degraded_max_s * 1000.0f) {
+    t_degraded_fill = t_degraded_max_s * 1000UL;
+    degraded_amount_g = t_degraded_fill * dg_per_s / 10000.0f;
+  }
+  else t_degraded_fill = t_fill;
+}
+
+// geschätzte Menge nach t_elapsed ms zeitgesteuerter Befüllung
+long degradedDelivered(uint32_t t_elapsed) {
+  return degraded_base_g + (long)(t_elapsed * (float)flow_rates[degraded_preset].dg_per_s / 10000.0f);
+}
+
+/*  =============================
+      Nachlauf und Überschwingen
+    ============================= */
+
+// Nach dem Schließen läuft noch Wasser aus dem Schlauch nach. Die Zustände 14 / 19 / 24 messen
+// deshalb weiter, bis das Gewicht stillsteht (Sanduhr statt Haken), und zeigen dann das
+// tatsächliche Endgewicht an. Das Überschwingen (Endgewicht - Sollwert) geht je VE in eine
+// laufende Statistik (Welford: Mittelwert, Varianz, größter Wert), die im EEPROM bleibt.
+// Anzeige über Einstellungen -> GEN (Zustand 43), seriell mit "overshoot".
+// Verworfen wird, wenn nach t_settle_max_s noch keine Ruhe ist oder das Gewicht unter den
+// Abschaltwert fällt (Behälter schon entnommen).
+struct OvershootStats {
+  uint16_t count;
+  float mean_g;                        // mittleres Überschwingen (g)
+  float m2;                            // Summe der Abweichungsquadrate, Varianz = m2 / (count - 1)
+  int16_t worst_g;                     // größtes Überschwingen (g)
+};
+
+OvershootStats overshoot_stats[FLOW_PRESETS];
+uint16_t t_settle_max_s = DEFAULT_T_SETTLE_MAX;
+bool settle_pending = false;           // Nachlauf wird noch gemessen
+uint8_t settle_preset = 0;
+long settle_cutoff_g = 0;              // netto beim Schließen
+uint32_t t_settle_started = 0;
+
+// nur in setup()
+void overshootLoad() {
+  if (EEPROM.read(addr_overshoot_saved_flag) == 169) EEPROM.get(addr_overshoot, overshoot_stats);
+  else memset(overshoot_stats, 0, sizeof(overshoot_stats));
+}
+
+void overshootClear(uint8_t preset) {
+  memset(&overshoot_stats[preset], 0, sizeof(OvershootStats));
+  eepromQueuePut(addr_overshoot + preset * sizeof(OvershootStats), overshoot_stats[preset]);
+  eepromQueuePut(addr_overshoot_saved_flag, (uint8_t)169);
+}
+
+void overshootRecord(uint8_t preset, long overshoot_g) {
+  OvershootStats& o = overshoot_stats[preset];
+  if (overshoot_g > 32767) overshoot_g = 32767;
+  if (overshoot_g < -32767) overshoot_g = -32767;
+  // bei vollem Zähler wirkt die Statistik wie ein sehr langsamer gleitender Mittelwert
+  if (o.count < 65535) o.count++;
+  float delta = overshoot_g - o.mean_g;
+  o.mean_g += delta / o.count;
+  o.m2 += delta * (overshoot_g - o.mean_g);
+  if (o.count == 1 || overshoot_g > o.worst_g) o.worst_g = overshoot_g;
+  eepromQueuePut(addr_overshoot + preset * sizeof(OvershootStats), o);
+  eepromQueuePut(addr_overshoot_saved_flag, (uint8_t)169);
+}
+
+float overshootDeviation(const OvershootStats& o) {
+  return o.count < 2 ? 0 : sqrt(o.m2 / (o.count - 1));
+}
+
+void overshootPrint() {
+  #ifdef SERIAL_ENABLED
+  for (uint8_t i = 0; i < FLOW_PRESETS; i++) {
+    const OvershootStats& o = overshoot_stats[i];
+    Serial.print(txt(TXT_OVERSHOOT_LIST));
+    Serial.print(i);
+    Serial.print(txt(TXT_SEPARATOR));
+    Serial.print(o.count);
+    Serial.print(txt(TXT_SEPARATOR));
+    Serial.print(o.mean_g, 1);
+    Serial.print(txt(TXT_SEPARATOR));
+    Serial.print(overshootDeviation(o), 1);
+    Serial.print(txt(TXT_SEPARATOR));
+    Serial.println(o.worst_g);
+  }
+  #endif
+}
+
+// Regulär beendete Befüllung (13 / 18 / 23 -> 14 / 19 / 24): Nachlauf messen
+void settleStart(uint32_t t, uint8_t preset, long net_g) {
+  settle_pending = true;
+  settle_preset = preset;
+  settle_cutoff_g = net_g;
+  t_settle_started = t;
+}
+
+// in 14 / 19 / 24 bei jedem Messwert
+void settleCapture(uint32_t t, long net_g, long target_g) {
+  if (!settle_pending) return;
+  if (t - t_settle_started > t_settle_max_s * 1000UL || net_g < settle_cutoff_g - (long)stable_band_g) {
+    settle_pending = false;
+    redraw_screen = true;
+    #ifdef SERIAL_ENABLED
+    Serial.println(txt(TXT_SETTLE_FAILED));
+    #endif
+    return;
+  }
+  // der Stillstand muss nach dem Schließen begonnen haben
+  if (!weight_stable || t - t_settle_started < t_stable) return;
+  settle_pending = false;
+  last_target_done_g = net_g;
+  overshootRecord(settle_preset, net_g - target_g);
+  redraw_screen = true;
+  #ifdef SERIAL_ENABLED
+  Serial.print(txt(TXT_SETTLED));
+  Serial.print(settle_preset);
+  Serial.print(txt(TXT_SEPARATOR));
+  Serial.print(settle_cutoff_g);
+  Serial.print(txt(TXT_SEPARATOR));
+  Serial.print(net_g);
+  Serial.print(txt(TXT_SEPARATOR));
+  Serial.println(net_g - target_g);
+  #endif
+}
+
+/*  =============================
+      Überwachung der Wiegezelle
+    ============================= */
+
+// Zusätzlich zum Timeout (kein Messwert) wird jeder Messwert geprüft, denn ein übersteuerter
+// Wandler oder eine unterbrochene Anregung liefert weiter Messwerte, die nach plausiblen Gewichten
+// aussehen. Ein erkannter Fehler führt in Zustand 2, der Code steht auf dem LCD und in
+// Modbus-Register 22. Der Notbetrieb greift nur beim Timeout, denn er endet mit dem nächsten
+// Messwert und der käme hier weiter.
+// E3 setzt voraus, dass die Messwerte rauschen, wie bei jeder echten Wiegezelle. Eine Quelle ohne
+// Rauschen (Simulator, Testaufbau mit festem Signal) löst E3 nach FAULT_STUCK_SAMPLES Messwerten
+// aus, im Simulator daher immer "noise" setzen.
+enum LoadcellFault : uint8_t {
+  FAULT_NONE,
+  FAULT_TIMEOUT,          // E1: kein Messwert für t_timeout
+  FAULT_RAIL,             // E2: Rohwert am Endwert des ADC (übersteuert, Brücke unterbrochen)
+  FAULT_STUCK,            // E3: immer derselbe Rohwert (DOUT hängt, Wandler steht)
+  FAULT_STEP,             // E4: unmögliche Sprünge zwischen zwei Messwerten (Wackelkontakt)
+  FAULT_FROZEN,           // E5: kein Anstieg bei offenem Ventil
+};
+
+#define FAULT_RAIL_SAMPLES 3      // Endwerte in Folge
+#define FAULT_STUCK_SAMPLES 8     // gleiche Rohwerte in Folge, das Rauschen ändert sonst jedes Mal die letzten Bits
+#define FAULT_STEP_SAMPLES 2      // unmögliche Sprünge in Folge, ein einzelner kann ein Stoß sein
+
+LoadcellFault loadcell_fault = FAULT_NONE;
+long fault_step_max_g = DEFAULT_FAULT_STEP_G;
+uint16_t t_fault_frozen = DEFAULT_T_FAULT_FROZEN;
+
+// Neuen Rohwert prüfen, gibt den Fehler zurück, sobald eine Prüfung anspricht
+LoadcellFault loadcellCheck(long raw, uint32_t t) {
+  static long last_raw = -1;
+  static long last_mass_g = 0;
+  static uint8_t rail_count = 0;
+  static uint8_t stuck_count = 0;
+  static uint8_t step_count = 0;
+  static bool frozen_armed = false;
+  static long frozen_reference_g = 0;
+  static uint32_t t_frozen_reference = 0;
+
+  if (raw <= HX711_RAW_MIN || raw >= HX711_RAW_MAX) rail_count++;
+  else rail_count = 0;
+  if (raw == last_raw) stuck_count++;
+  else stuck_count = 0;
+
+  long mass_g = calibratedMass(raw - loadcell.getTareOffset());
+  if (last_raw >= 0 && labs(mass_g - last_mass_g) > fault_step_max_g) step_count++;
+  else step_count = 0;
+  last_raw = raw;
+  last_mass_g = mass_g;
+
+  if (rail_count >= FAULT_RAIL_SAMPLES) return FAULT_RAIL;
+  if (stuck_count >= FAULT_STUCK_SAMPLES - 1) return FAULT_STUCK;
+  if (step_count >= FAULT_STEP_SAMPLES) return FAULT_STEP;
+
+  // Ventil offen: das Gewicht muss innerhalb von t_fault_frozen um mehr als das Stillstandsband steigen
+  if (!output_enabled || t_fault_frozen == 0) frozen_armed = false;
+  else if (!frozen_armed || current_weight_g > frozen_reference_g + stable_band_g) {
+    frozen_armed = true;
+    frozen_reference_g = current_weight_g;
+    t_frozen_reference = t;
+  }
+  else if (t - t_frozen_reference >= t_fault_frozen) return FAULT_FROZEN;
+
+  return FAULT_NONE;
+}
+
+/*  =============================
+      Behälter-Bibliothek
+    ============================= */
+
+// Ohne VE (Schalter auf 0) wird ein leerer Behälter am Leergewicht erkannt: steht das Gewicht
+// still und liegt es im Toleranzband genau eines Eintrags, werden dessen Sollwert und Tara
+// übernommen (Anzeige netto, Behälternummer in Spalte 11). Passen mehrere Einträge, wird '?'
+// angezeigt und der Start gesperrt, bis ein eindeutiger Behälter auf der Waage steht. Passt
+// keiner, wird wie bisher brutto mit dem eigenen Sollwert des Bedieners gefüllt. Ausgewertet wird einmal je neuem Stillstand, ein von
+// Hand geänderter Sollwert bleibt also erhalten, bis der Behälter gewechselt wird.
+// Gepflegt wird die Bibliothek über die serielle Schnittstelle ("containers", "container ...").
+#define CONTAINER_SLOTS 8
+#define CONTAINER_TOLERANCE_MAX 5000
+#define CONTAINER_NONE -1
+#define CONTAINER_AMBIGUOUS -2
+
+struct Container {
+  long tare_g;
+  long target_g;              // netto
+  uint16_t tolerance_g;       // 0 = Eintrag leer
+};
+
+int8_t container_match = CONTAINER_NONE;   // Index des erkannten Behälters bzw. CONTAINER_NONE / _AMBIGUOUS
+bool container_evaluated = false;          // aktueller Stillstand wurde schon ausgewertet
+long container_user_target_g = 0;          // eigener Sollwert des Bedieners, solange ein Behälter gilt
+
+bool containerValid(const Container& c) {
+  return c.tolerance_g > 0 && c.tolerance_g <= CONTAINER_TOLERANCE_MAX
+      && c.tare_g >= AUTOCYCLE_MIN_CONTAINER_G && c.tare_g <= MAX_WEIGHT_OFFSET
+      && c.target_g >= MIN_WEIGHT_SETPOINT && c.target_g <= MAX_WEIGHT_SETPOINT;
+}
+
+bool containerGet(uint8_t index, Container& c) {
+  EEPROM.get(addr_containers + index * sizeof(Container), c);
+  return containerValid(c);
+}
+
+// im Zustand 22 bei jedem Messwert aufrufen
+void containerRecognize() {
+  if (!weight_stable || !loadcell_warm || container_evaluated) return;
+  // das EEPROM darf nur gelesen werden, wenn die Schreib-Warteschlange leer ist
+  if (eepromQueueBusy()) return;
+  container_evaluated = true;
+
+  int8_t match = CONTAINER_NONE;
+  Container found;
+  if (current_weight_g >= AUTOCYCLE_MIN_CONTAINER_G) {
+    for (uint8_t i = 0; i < CONTAINER_SLOTS; i++) {
+      Container c;
+      if (!containerGet(i, c) || labs(current_weight_g - c.tare_g) > c.tolerance_g) continue;
+      if (match != CONTAINER_NONE) {
+        match = CONTAINER_AMBIGUOUS;
+        break;
+      }
+      match = i;
+      found = c;
+    }
+  }
+
+  if (match >= 0) {
+    // beim ersten erkannten Behälter den eigenen Sollwert merken, bei Wechsel A -> B nicht
+    if (container_match < 0) container_user_target_g = p0_target_g;
+    p0_target_g = found.target_g;
+    p0_tara_offset_g = found.tare_g;
+    if (use_keytones && match != container_match) tone(PIN_BEEP, BEEP_FREQ_CLICK, beep_length_short);
+    #ifdef SERIAL_ENABLED
+    Serial.print(txt(TXT_CONTAINER_MATCH));
+    Serial.print(match + 1);
+    Serial.print(txt(TXT_SEPARATOR));
+    Serial.print(found.tare_g);
+    Serial.print(txt(TXT_SEPARATOR));
+    Serial.println(found.target_g);
+    #endif
+  }
+  else {
+    // kein (eindeutiger) Behälter mehr: eigenen Sollwert des Bedieners zurück, brutto füllen
+    if (container_match >= 0) p0_target_g = container_user_target_g;
+    p0_tara_offset_g = 0;
+    if (match == CONTAINER_AMBIGUOUS) {
+      if (use_keytones) tone(PIN_BEEP, BEEP_FREQ_ERR, beep_length_err);
+      #ifdef SERIAL_ENABLED
+      Serial.print(txt(TXT_CONTAINER_AMBIGUOUS));
+      Serial.println(current_weight_g);
+      #endif
+    }
+  }
+  if (match != container_match) redraw_screen = true;
+  container_match = match;
+}
+
+// Start ohne VE: nicht schon voll und Behälter eindeutig
+bool containerStartAllowed() {
+  return current_weight_g - p0_tara_offset_g < p0_target_g && container_match != CONTAINER_AMBIGUOUS;
+}
+
+void containersPrint() {
+  #ifdef SERIAL_ENABLED
+  while (eepromQueueBusy());
+  for (uint8_t i = 0; i < CONTAINER_SLOTS; i++) {
+    Container c;
+    if (!containerGet(i, c)) continue;
+    Serial.print(txt(TXT_CONTAINER_LIST));
+    Serial.print(i + 1);
+    Serial.print(txt(TXT_SEPARATOR));
+    Serial.print(c.tare_g);
+    Serial.print(txt(TXT_SEPARATOR));
+    Serial.print(c.tolerance_g);
+    Serial.print(txt(TXT_SEPARATOR));
+    Serial.println(c.target_g);
+  }
+  #endif
+}
+
+// "container <nr> <tara_g> <toleranz_g> <sollwert_g>" setzt, "container <nr>" löscht einen Eintrag
+void containerCommand(char* args) {
+  char* end;
+  long index = strtol(args, &end, 10) - 1;
+  if (index < 0 || index >= CONTAINER_SLOTS) return;
+  Container c;
+  c.tare_g = strtol(end, &end, 10);
+  c.tolerance_g = strtol(end, &end, 10);
+  c.target_g = strtol(end, &end, 10);
+  if (!containerValid(c)) c.tolerance_g = 0;
+  eepromQueuePut(addr_containers + index * sizeof(Container), c);
+  // neu auswerten, der Eintrag kann den aufgestellten Behälter betreffen
+  container_evaluated = false;
+}
+
+/*  =============================
+      Rezepte
+    ============================= */
+
+// Ein Rezept ist eine Folge von Schritten (Ausgang, Sollwert netto, Pause), die nacheinander in
+// denselben Behälter dosiert werden, z.B. Osmosewasser und ein Mineralkonzentrat. Vor jedem
+// Schritt wird bei Stillstand nachtariert, nach dem Schließen die Pause und der Stillstand
+// abgewartet und die erreichte Menge festgehalten (Anzeige in Zustand 42, serielle Ausgabe).
+// Start über Einstellungen -> REZ (Zustand 39), Ablauf in Zustand 40. Gepflegt werden die
+// Rezepte über die serielle Schnittstelle ("recipes", "recipe ...").
+#define RECIPE_COUNT 2
+#define RECIPE_STEPS 7
+#define RECIPE_PAUSE_MAX_S 63
+
+struct RecipeStep {
+  uint32_t target_g : 24;             // Sollwert netto (g)
+  uint32_t output : 2;                // 0 = Hauptausgang, 1 / 2 = Ausgang 2 / 3
+  uint32_t pause_s : 6;               // Pause nach dem Schließen (s), danach Stillstand abwarten
+};
+
+struct Recipe {
+  uint8_t count;                      // Anzahl Schritte, 0xFF (gelöschtes EEPROM) = leer
+  RecipeStep steps[RECIPE_STEPS];
+};
+
+static_assert(addr_recipes + RECIPE_COUNT * sizeof(Recipe) <= 0x1E0, "Rezepte überschreiten ihren EEPROM-Bereich");
+
+enum RecipePhase : uint8_t {
+  RECIPE_TARE,                        // auf Stillstand warten, dann nachtarieren und öffnen
+  RECIPE_FILL,                        // Ausgang offen bis zum Sollwert
+  RECIPE_SETTLE,                      // Pause und Stillstand abwarten, dann Ergebnis festhalten
+};
+
+Recipe recipe;                        // ausgewähltes bzw. laufendes Rezept
+uint8_t recipe_index = 0;
+uint8_t recipe_step = 0;              // laufender Schritt, am Ende Anzahl der fertigen Schritte
+RecipePhase recipe_phase = RECIPE_TARE;
+long recipe_tare_g = 0;               // Brutto beim Nachtarieren des laufenden Schritts
+long recipe_actual_g[RECIPE_STEPS];   // erreichte Menge je Schritt
+uint32_t t_recipe_phase = 0;
+bool recipe_aborted = false;
+
+uint16_t recipeAddr(uint8_t index) {
+  return addr_recipes + index * sizeof(Recipe);
+}
+
+// Rezept ins RAM laden, wartet ggf. auf die EEPROM-Warteschlange
+void recipeLoad(uint8_t index) {
+  while (eepromQueueBusy());
+  EEPROM.get(recipeAddr(index), recipe);
+  if (recipe.count > RECIPE_STEPS) recipe.count = 0;
+  recipe_index = index;
+}
+
+void recipesPrint() {
+  #ifdef SERIAL_ENABLED
+  uint8_t selected = recipe_index;
+  for (uint8_t r = 0; r < RECIPE_COUNT; r++) {
+    recipeLoad(r);
+    for (uint8_t i = 0; i < recipe.count; i++) {
+      Serial.print(txt(TXT_RECIPE_LIST));
+      Serial.print(r + 1);
+      Serial.print(txt(TXT_SEPARATOR));
+      Serial.print(i + 1);
+      Serial.print(txt(TXT_SEPARATOR));
+      Serial.print(recipe.steps[i].output + 1);
+      Serial.print(txt(TXT_SEPARATOR));
+      Serial.print((long)recipe.steps[i].target_g);
+      Serial.print(txt(TXT_SEPARATOR));
+      Serial.println(recipe.steps[i].pause_s);
+    }
+  }
+  recipeLoad(selected);
+  #endif
+}
+
+// "recipe <nr> <schritt> <ausgang 1-3> <sollwert_g> <pause_s>" setzt einen Schritt (höchstens
+// einen nach dem letzten), "recipe <nr> <schritt>" kürzt das Rezept vor diesem Schritt
+void recipeCommand(char* args) {
+  // das laufende bzw. angezeigte Rezept nicht unter der Hand ändern
+  if (state == 40 || state == 42) return;
+  char* end;
+  long index = strtol(args, &end, 10) - 1;
+  long step = strtol(end, &end, 10) - 1;
+  if (index < 0 || index >= RECIPE_COUNT || step < 0 || step >= RECIPE_STEPS) return;
+  recipeLoad(index);
+  if (step > recipe.count) return;
+  long output = strtol(end, &end, 10) - 1;
+  long target_g = strtol(end, &end, 10);
+  long pause_s = strtol(end, &end, 10);
+  if (output < 0) recipe.count = step;
+  else {
+    if (output >= 3 || target_g < 1 || target_g > MAX_WEIGHT_SETPOINT || pause_s < 0 || pause_s > RECIPE_PAUSE_MAX_S) return;
+    recipe.steps[step].output = output;
+    recipe.steps[step].target_g = target_g;
+    recipe.steps[step].pause_s = pause_s;
+    eepromQueuePut(recipeAddr(index) + offsetof(Recipe, steps) + step * sizeof(RecipeStep), recipe.steps[step]);
+    if (step == recipe.count) recipe.count++;
+  }
+  eepromQueuePut(recipeAddr(index), recipe.count);
+}
+
+// Einstellungs-Bitvektor aus den aktuell aktiven Einstellungen erstellen
+uint8_t getToggleSettingsFromState() {
+  uint8_t settings_bitvector = 0;
+  settings_bitvector = use_keytones ? settings_bitvector | 1 << SETTINGS_KEYTONE : settings_bitvector & ~ (1 << SETTINGS_KEYTONE);
+  settings_bitvector = use_endtone ? settings_bitvector | 1 << SETTINGS_ENDTONE : settings_bitvector & ~ (1 << SETTINGS_ENDTONE);
+  settings_bitvector = use_autocycle ? settings_bitvector | 1 << SETTINGS_AUTOCYCLE : settings_bitvector & ~ (1 << SETTINGS_AUTOCYCLE);
+  settings_bitvector = use_direct_edit ? settings_bitvector | 1 << SETTINGS_DIRECTEDIT : settings_bitvector & ~ (1 << SETTINGS_DIRECTEDIT);
+  settings_bitvector = use_topup ? settings_bitvector | 1 << SETTINGS_TOPUP : settings_bitvector & ~ (1 << SETTINGS_TOPUP);
+  settings_bitvector = use_degraded ? settings_bitvector | 1 << SETTINGS_DEGRADED : settings_bitvector & ~ (1 << SETTINGS_DEGRADED);
+  return settings_bitvector;
+}
+
+// Aktive Einstellungen aus Einstellungs-Bitvektor übernehmen
+void setToggleSettingsFromBitvector(uint8_t settings_bitvector) {
+  use_keytones = (settings_bitvector & (1 << SETTINGS_KEYTONE)) >> SETTINGS_KEYTONE;
+  use_endtone = (settings_bitvector & (1 << SETTINGS_ENDTONE)) >> SETTINGS_ENDTONE;
+  use_autocycle = (settings_bitvector & (1 << SETTINGS_AUTOCYCLE)) >> SETTINGS_AUTOCYCLE;
+  use_direct_edit = (settings_bitvector & (1 << SETTINGS_DIRECTEDIT)) >> SETTINGS_DIRECTEDIT;
+  use_topup = (settings_bitvector & (1 << SETTINGS_TOPUP)) >> SETTINGS_TOPUP;
+  use_degraded = (settings_bitvector & (1 << SETTINGS_DEGRADED)) >> SETTINGS_DEGRADED;
+}
+
+/*  =============================
+      Parameter-Registry
+    ============================= */
+
+// Alle zur Laufzeit einstellbaren Größen mit Typ, Bereich, Vorgabe und EEPROM-Adresse als
+// Tabelle im Flash. Menü (Zustand 35/36) und serielle Befehle lesen und schreiben nur über diese
+// Tabelle, ein neuer Parameter braucht also nur eine Zeile hier und eine Variable. Werte gelten
+// sofort, die Variablen werden direkt gelesen. Gespeichert wird der Wert wie er im RAM liegt,
+// PARAM_BOOL sind die Schalter der Einstellungen und liegen im Einstellungs-Bitvektor.
+enum ParamType : uint8_t {
+  PARAM_BOOL,
+  PARAM_U8,
+  PARAM_U16,
+  PARAM_U32,
+  PARAM_I32,
+};
+
+#define PARAM_NAME_LENGTH 11
+
+struct Param {
+  char name[PARAM_NAME_LENGTH];
+  ParamType type;
+  uint16_t eeprom;            // bei PARAM_BOOL ohne Bedeutung
+  void* value;
+  long min_value;
+  long max_value;
+  long default_value;
+  uint16_t step;              // Schrittweite im Menü, vor Beschleunigung
+};
+
+#define DEFAULT_TOGGLE(bit) ((DEFAULT_TOGGLESETTINGS >> (bit)) & 1)
+
+const Param params[] PROGMEM = {
+  // name           type        eeprom              value                      min                  max                  default                           step
+  { "t_screen",     PARAM_U16,  addr_params + 0,    &t_intv_screen,            20,                  1000,                DEFAULT_T_INTV_SCREEN,            10 },
+  { "t_switch",     PARAM_U16,  addr_params + 2,    &t_debounce_switch,        1,                   500,                 DEFAULT_T_DEBOUNCE_SWITCH,        1 },
+  { "t_button",     PARAM_U16,  addr_params + 4,    &t_debounce_button,        1,                   200,                 DEFAULT_T_DEBOUNCE_BUTTON,        1 },
+  { "t_long",       PARAM_U16,  addr_params + 6,    &t_long_click,             100,                 5000,                DEFAULT_T_LONG_CLICK,             10 },
+  { "t_stable",     PARAM_U16,  addr_params + 8,    &t_stable,                 100,                 10000,               DEFAULT_T_STABLE,                 100 },
+  { "t_autocyc",    PARAM_U16,  addr_params + 10,   &t_autocycle_confirm,      500,                 9000,                DEFAULT_T_AUTOCYCLE_CONFIRM,      100 },
+  { "t_topup",      PARAM_U32,  addr_params + 12,   &t_topup_min_off,          0,                   3600000,             DEFAULT_T_TOPUP_MIN_OFF,          1000 },
+  { "t_timeout",    PARAM_U16,  addr_params + 16,   &t_timeout_weight_reading, 500,                 10000,               DEFAULT_T_TIMEOUT_WEIGHT_READING, 100 },
+  { "beep_turn",    PARAM_U16,  addr_params + 18,   &beep_length_turn,         1,                   1000,                BEEP_LENGTH_TURN,                 1 },
+  { "beep_short",   PARAM_U16,  addr_params + 20,   &beep_length_short,        1,                   1000,                BEEP_LENGTH_SHORT,                1 },
+  { "beep_long",    PARAM_U16,  addr_params + 22,   &beep_length_long,         1,                   2000,                BEEP_LENGTH_LONG,                 10 },
+  { "beep_err",     PARAM_U16,  addr_params + 24,   &beep_length_err,          1,                   2000,                BEEP_LENGTH_ERR,                  10 },
+  { "band_stab",    PARAM_U16,  addr_params + 26,   &stable_band_g,            1,                   1000,                STABLE_BAND_G,                    1 },
+  { "band_tare",    PARAM_U16,  addr_params + 28,   &autocycle_tare_band_g,    10,                  5000,                AUTOCYCLE_TARE_BAND_G,            10 },
+  { "topup_hyst",   PARAM_U8,   addr_params + 30,   &topup_hysteresis_percent, 1,                   50,                  TOPUP_HYSTERESIS_PERCENT,         1 },
+  { "max_target",   PARAM_I32,  addr_params + 31,   &limit_target_max_g,       MIN_WEIGHT_SETPOINT, MAX_WEIGHT_SETPOINT, MAX_WEIGHT_SETPOINT,              100 },
+  { "max_offset",   PARAM_I32,  addr_params + 35,   &limit_offset_max_g,       MIN_WEIGHT_OFFSET,   MAX_WEIGHT_OFFSET,   MAX_WEIGHT_OFFSET,                10 },
+  { "deg_pct",      PARAM_U8,   addr_params + 39,   &degraded_percent,         50,                  95,                  DEFAULT_DEGRADED_PERCENT,         5 },
+  { "t_deg_max",    PARAM_U16,  addr_params + 40,   &t_degraded_max_s,         10,                  3600,                DEFAULT_T_DEGRADED_MAX,           10 },
+  { "step_max",     PARAM_I32,  addr_params + 42,   &fault_step_max_g,         100,                 10000000,            DEFAULT_FAULT_STEP_G,             100 },
+  { "t_frozen",     PARAM_U16,  addr_params + 46,   &t_fault_frozen,           0,                   60000,               DEFAULT_T_FAULT_FROZEN,           1000 },
+  { "t_settle",     PARAM_U16,  addr_params + 48,   &t_settle_max_s,           2,                   120,                 DEFAULT_T_SETTLE_MAX,             1 },
+  { "cap_post",     PARAM_U8,   addr_params + 50,   &capture_post,             0,                   CAPTURE_SAMPLES - 1, DEFAULT_CAPTURE_POST,             1 },
+  { "noise_z",      PARAM_U16,  addr_params + 51,   &noisetest_z,              100,                 600,                 DEFAULT_NOISETEST_Z,              1 },
+  { "cap_save",     PARAM_U16,  addr_params + 53,   &capture_save_min,         0,                   1440,                DEFAULT_CAPTURE_SAVE_MIN,         10 },
+  { "keytone",      PARAM_BOOL, 0,                  &use_keytones,             0,                   1,                   DEFAULT_TOGGLE(SETTINGS_KEYTONE),    1 },
+  { "endtone",      PARAM_BOOL, 0,                  &use_endtone,              0,                   1,                   DEFAULT_TOGGLE(SETTINGS_ENDTONE),    1 },
+  { "autocycle",    PARAM_BOOL, 0,                  &use_autocycle,            0,                   1,                   DEFAULT_TOGGLE(SETTINGS_AUTOCYCLE),  1 },
+  { "directedit",   PARAM_BOOL, 0,                  &use_direct_edit,          0,                   1,                   DEFAULT_TOGGLE(SETTINGS_DIRECTEDIT), 1 },
+  { "topup",        PARAM_BOOL, 0,                  &use_topup,                0,                   1,                   DEFAULT_TOGGLE(SETTINGS_TOPUP),      1 },
+  { "degraded",     PARAM_BOOL, 0,                  &use_degraded,             0,                   1,                   DEFAULT_TOGGLE(SETTINGS_DEGRADED),   1 },
+};
+
+#define PARAM_COUNT (sizeof(params) / sizeof(params[0]))
+
+long param_edit_value = 0;         // Zustand 36: bearbeiteter, noch nicht übernommener Wert
+
+// Werte, die nicht direkt als Variable gelesen werden, übernehmen (nach dem Scheduler definiert)
+void paramsApply();
+
+// Fristen aller Tasks ab jetzt, am Ende von setup() (nach dem Scheduler definiert)
+void tasksStart();
+
+void paramFetch(uint8_t id, Param& p) {
+  memcpy_P(&p, &params[id], sizeof(Param));
+}
+
+uint8_t paramSize(ParamType type) {
+  switch (type) {
+    case PARAM_BOOL:
+    case PARAM_U8: return 1;
+    case PARAM_U16: return 2;
+    default: return 4;
+  }
+}
+
+long paramGet(uint8_t id) {
+  Param p;
+  paramFetch(id, p);
+  switch (p.type) {
+    case PARAM_BOOL: return *(bool*)p.value;
+    case PARAM_U8: return *(uint8_t*)p.value;
+    case PARAM_U16: return *(uint16_t*)p.value;
+    case PARAM_U32: return *(uint32_t*)p.value;
+    default: return *(long*)p.value;
+  }
+}
+
+void paramStore(const Param& p, long value) {
+  switch (p.type) {
+    case PARAM_BOOL: { *(bool*)p.value = value; break; }
+    case PARAM_U8: { *(uint8_t*)p.value = value; break; }
+    case PARAM_U16: { *(uint16_t*)p.value = value; break; }
+    case PARAM_U32: { *(uint32_t*)p.value = value; break; }
+    default: { *(long*)p.value = value; break; }
+  }
+}
+
+// Wert prüfen, übernehmen und ins EEPROM schreiben. Gibt false zurück, wenn außerhalb des Bereichs.
+bool paramSet(uint8_t id, long value) {
+  Param p;
+  paramFetch(id, p);
+  if (value < p.min_value || value > p.max_value) return false;
+  paramStore(p, value);
+  if (p.type == PARAM_BOOL) eepromQueuePut(addr_toggle_settings, getToggleSettingsFromState());
+  else {
+    eepromQueueWrite(p.eeprom, p.value, paramSize(p.type));
+    eepromQueuePut(addr_params_saved_flag, (uint8_t)169);
+  }
+  paramsApply();
+  return true;
+}
+
+// nur in setup(): gespeicherte Werte laden, fehlende oder ungültige durch die Vorgabe ersetzen
+void paramsLoad() {
+  bool saved = EEPROM.read(addr_params_saved_flag) == 169;
+  for (uint8_t id = 0; id < PARAM_COUNT; id++) {
+    Param p;
+    paramFetch(id, p);
+    if (p.type == PARAM_BOOL) continue;
+    long value = 0;
+    for (uint8_t i = 0; i < paramSize(p.type); i++) value |= (long)EEPROM.read(p.eeprom + i) << (8 * i);
+    if (!saved || value < p.min_value || value > p.max_value) value = p.default_value;
+    paramStore(p, value);
+  }
+  paramsApply();
+  #ifdef SERIAL_ENABLED
+  if (!saved) Serial.println(txt(TXT_NO_PARAMS));
+  #endif
+}
+
+// Nummer (ab 1) oder Name, PARAM_COUNT wenn unbekannt
+uint8_t paramFind(const char* key) {
+  if (key[0] >= '0' && key[0] <= '9') {
+    int id = atoi(key) - 1;
+    return id >= 0 && id < (int)PARAM_COUNT ? id : PARAM_COUNT;
+  }
+  for (uint8_t id = 0; id < PARAM_COUNT; id++) {
+    if (strcmp_P(key, params[id].name) == 0) return id;
+  }
+  return PARAM_COUNT;
+}
+
+void paramPrint(uint8_t id) {
+  #ifdef SERIAL_ENABLED
+  Param p;
+  paramFetch(id, p);
+  Serial.print(txt(TXT_PARAM));
+  Serial.print(id + 1);
+  Serial.print(txt(TXT_SEPARATOR));
+  Serial.print(p.name);
+  Serial.print(txt(TXT_SEPARATOR));
+  Serial.print(paramGet(id));
+  Serial.print(txt(TXT_SEPARATOR));
+  Serial.print(p.min_value);
+  Serial.print(txt(TXT_SEPARATOR));
+  Serial.print(p.max_value);
+  Serial.print(txt(TXT_SEPARATOR));
+  Serial.println(p.default_value);
+  #endif
+}
+
+// "set <nr|name> <wert>"
+void paramCommand(char* args) {
+  #ifdef SERIAL_ENABLED
+  char* value = strchr(args, ' ');
+  if (value != nullptr) *value++ = '\0';
+  uint8_t id = paramFind(args);
+  if (id >= PARAM_COUNT || value == nullptr || !paramSet(id, atol(value))) {
+    Serial.print(txt(TXT_PARAM_UNKNOWN));
+    Serial.println(args);
+    return;
+  }
+  paramPrint(id);
+  #endif
+}
+
+// Vorzeichen und "dd.d" kg bzw. ab 100 kg ganze kg, ab 10 t unendlich (5 Zeichen)
+void weightCells(long w, char* cells) {
+  cells[0] = w < 0 ? '-' : ' ';
+  if (w < 0) w = 0 - w;
+  if (!formatWeight(w, 1, cells + 1)) {
+    cells[1] = ' ';
+    cells[2] = ' ';
+    cells[3] = ' ';
+    cells[4] = 3;
+  }
+}
+
+// Ziffern-Bearbeitung: die drei bearbeitbaren Stellen (sub_state 0-2) sind immer die letzten
+// drei angezeigten Ziffern, sie hängen also vom Anzeigebereich von formatWeight() ab.
+// Stellenwerte (g) von 100 kg bis 10 g, die erste bearbeitbare Stelle ist ein Index hierin.
+const long edit_places[5] PROGMEM = {100000, 10000, 1000, 100, 10};
+
+long editStep(uint8_t first, uint8_t position) {
+  return pgm_read_dword(&edit_places[first + position]);
+}
+
+// Sollwert "dd.d" bis 99,9 kg: 10 kg, 1 kg, 0.1 kg; darüber "dddd": 100 kg, 10 kg, 1 kg
+uint8_t targetEditFirst(long target) {
+  return target < FMT_WEIGHT_KILO_FROM ? 1 : 0;
+}
+
+// Cursor-Spalte der bearbeiteten Stelle im Sollwert (Spalten 7-10)
+uint8_t targetEditColumn(long target, uint8_t position) {
+  if (use_direct_edit) return 10;
+  if (target < FMT_WEIGHT_KILO_FROM) return position == 0 ? 7 : position == 1 ? 8 : 10;
+  return 8 + position;
+}
+
+// Tara-Versatz "d.dd" bis 9,99 kg: 1 kg, 0.1 kg, 0.01 kg; bis 99,9 kg "dd.d": 10 kg, 1 kg,
+// 0.1 kg; darüber "dddd": 100 kg, 10 kg, 1 kg
+uint8_t offsetEditFirst(long offset) {
+  if (offset < FMT_WEIGHT_DECI_FROM) return 2;
+  return offset < FMT_WEIGHT_KILO_FROM ? 1 : 0;
+}
+
+// Cursor-Spalte der bearbeiteten Stelle im Tara-Versatz (Spalten 11-14)
+uint8_t offsetEditColumn(long offset, uint8_t position) {
+  if (use_direct_edit) return 14;
+  if (offset < FMT_WEIGHT_DECI_FROM) return position == 0 ? 11 : position == 1 ? 13 : 14;
+  if (offset < FMT_WEIGHT_KILO_FROM) return position == 0 ? 11 : position == 1 ? 12 : 14;
+  return 12 + position;
+}
+
+// Ganzwert-Eingabe: Schrittweite ist die letzte angezeigte Stelle, im gröberen Bereich also x10
+long directEditStep(long value, long step, long coarse_from) {
+  return value >= coarse_from ? step * 10 : step;
+}
+
+/*  =============================
+      Bildschirm-Layouts
+    ============================= */
+
+// Die Hauptbildschirme teilen sich je ein Layout für VE 1, VE 2 und ohne VE, die Werte der
+// Felder kommen aus der VE des aktuellen Zustands (12-16 VE 1, 17-21 VE 2, in 30 die des
+// Journals, sonst ohne VE).
+enum ScreenFieldId : uint8_t {
+  FIELD_WEIGHT,           // 5: Vorzeichen und Nettogewicht
+  FIELD_DONE_WEIGHT,      // 5: erreichtes Gewicht der letzten Befüllung
+  FIELD_TARGET,           // 4: Sollwert
+  FIELD_LAST_TARGET,      // 4: Sollwert der letzten Befüllung
+  FIELD_OFFSET,           // 4: Tara-Versatz
+  FIELD_PRESET,           // 1: '1' / '2', Kreuz ohne VE
+  FIELD_WARM,             // 1: Sanduhr, solange die Wiegezelle einschwingt
+  FIELD_CONTAINER,        // 1: erkannter Behälter, '?' = nicht eindeutig
+  FIELD_TOPUP,            // 8: "NF", Anzahl Zyklen und Sanduhr, nur wenn Nachfüllen an
+  FIELD_DURATION_MIN,     // 2: Füllzeit Minuten, ab 100 min unendlich
+  FIELD_DURATION_SEC,     // 2: Füllzeit Sekunden
+  FIELD_AUTOCYCLE,        // 6: Phase des Auto-Zyklus, nur wenn Auto-Zyklus an
+  FIELD_CAL_POINTS,       // 1: Anzahl erfasster Kalibrierpunkte
+  FIELD_CAL_POINT_STATUS, // 8: letzter Punkt erfasst / verworfen
+  FIELD_DEGRADED_AMOUNT,  // 4: geplante Menge im Notbetrieb
+  FIELD_DEGRADED_TIME,    // 4: Restzeit (s) der zeitgesteuerten Befüllung
+  FIELD_FAULT_CODE,       // 2: Fehlercode der Wiegezelle "E1" ...
+  FIELD_FAULT_TEXT,       // 16: Beschreibung des Fehlers
+  FIELD_DONE_STATUS,      // 1: Sanduhr während des Nachlaufs, dann Haken
+  FIELD_OVERSHOOT_HEAD,   // 16: Auswahl in 43: Cursor, VE, Anzahl, größtes Überschwingen bzw. zurück
+  FIELD_OVERSHOOT_STATS,  // 16: Mittelwert und Standardabweichung
+  FIELD_RECIPE_ENTRY,     // 16: Auswahl in 39: Cursor, Rezept-Nr. und Anzahl Schritte bzw. zurück
+  FIELD_RECIPE_STEP,      // 1: laufender Schritt
+  FIELD_RECIPE_COUNT,     // 1: Anzahl Schritte
+  FIELD_RECIPE_OUTPUT,    // 1: Ausgang des laufenden Schritts
+  FIELD_RECIPE_PHASE,     // 6: Tara / aktiv / Pause
+  FIELD_RECIPE_STATUS,    // 1: Haken bzw. Kreuz nach Abbruch
+  FIELD_RECIPE_VIEW_STEP, // 1: in 42 angezeigter Schritt
+  FIELD_RECIPE_VIEW_TARGET, // 4: dessen Sollwert
+  FIELD_RECIPE_VIEW_ACTUAL, // 4: erreichte Menge
+  FIELD_RECIPE_VIEW_ERROR,  // 5: Abweichung mit Vorzeichen
+  FIELD_EDIT_OK,          // 1: Haken / Kreuz des bearbeiteten Werts
+  FIELD_KNOWN_MASS,       // 5: bekannte Masse "dd.dd" kg
+  FIELD_NOISE_COUNT,      // 4: bisher gesammelte Messwerte
+  FIELD_NOISE_ENOB,       // 4: effektive Auflösung in Bit
+  FIELD_NOISE_SD,         // 4: Std.-Abw. in g
+  FIELD_NOISE_WINDOW,     // 3: 'N' und vorgeschlagenes Fenster, '!' = Vorgabe nicht erreichbar
+  FIELD_SETTINGS_TOP,     // 16: Einstellungen, obere Zeile der Seite mit Cursor und Schaltern
+  FIELD_SETTINGS_BOTTOM,  // 16: untere Zeile
+  FIELD_PARAM_NAME,       // 16: Auswahl in 35: Cursor, Nummer und Name bzw. zurück
+  FIELD_PARAM_VALUE,      // 16: Wert, Cursor bei der Bearbeitung in 36
+};
+
+uint8_t statePreset() {
+  if (state == 30) return journal.preset;
+  if (state >= 12 && state <= 16) return 1;
+  if (state >= 17 && state <= 21) return 2;
+  if (state == 37 || state == 38) return degraded_preset;
+  return 0;
+}
+
+long stateTarget() {
+  if (state == 40) return recipe.steps[recipe_step].target_g;
+  if (state == 30) return journal.target_g;
+  return presetTarget(statePreset());
+}
+
+long stateOffset() {
+  if (state == 40) return recipe_tare_g;
+  if (state == 30) return journal.offset_g;
+  switch (statePreset()) {
+    case 1: return p1_tara_offset_g;
+    case 2: return p2_tara_offset_g;
+    default: return p0_tara_offset_g;
+  }
+}
+
+// Text auf count Zeichen, rechts mit Leerzeichen aufgefüllt
+void textCells(TextId id, char* cells, uint8_t count) {
+  const char* p = (const char*)txt(id);
+  for (uint8_t i = 0; i < count; i++) {
+    char c = pgm_read_byte(p);
+    if (c == '\0') c = ' ';
+    else p++;
+    cells[i] = c;
+  }
+}
+
+// Sollwert bzw. Tara-Versatz wird bearbeitet
+bool stateEditsTarget() {
+  return state == 15 || state == 20 || state == 25;
+}
+
+bool stateEditsOffset() {
+  return state == 16 || state == 21;
+}
+
+// Einstellungen (26): Seiten mit je 2 Zeilen zu 3 Einträgen à 6 Zeichen, Cursor vor dem Eintrag,
+// Schalter 3 Zeichen dahinter. Texte je Zeile, die obere beginnt hinter dem Zurück-Zeichen.
+const TextId settings_rows[] PROGMEM = {
+  TXT_SETTINGS_TOGGLES, TXT_SETTINGS_ACTIONS, TXT_SETTINGS_TOGGLES_2, TXT_SETTINGS_TOGGLES_3, TXT_SETTINGS_ACTIONS_3,
+};
+
+// Schalter eines Eintrags: 1 / 0, -1 = kein Schalter
+int8_t settingsToggle(uint8_t entry) {
+  switch (entry) {
+    case 1: return use_keytones;
+    case 2: return use_endtone;
+    case 7: return use_autocycle;
+    case 8: return use_direct_edit;
+    case 9: return use_topup;
+    default: return -1;
+  }
+}
+
+void settingsRowCells(uint8_t row, char* cells) {
+  uint8_t first = sub_state / 6 * 6 + row * 3;
+  memset(cells, ' ', SCREEN_COLS);
+  if (first / 3 < sizeof(settings_rows) / sizeof(settings_rows[0])) {
+    TextId text = (TextId)pgm_read_byte(&settings_rows[first / 3]);
+    if (row == 0) {
+      cells[1] = 4;
+      textCells(text, cells + 7, 9);
+    }
+    else textCells(text, cells + 1, 15);
+  }
+  for (uint8_t col = 0; col < 3 && first + col < SETTINGS_MENU_ENTRIES; col++) {
+    uint8_t entry = first + col;
+    if (sub_state == entry) cells[col * 6] = 0;
+    int8_t toggle = settingsToggle(entry);
+    if (toggle >= 0) cells[col * 6 + 3] = toggle ? 1 : 2;
+  }
+}
+
+// Wert des Parameters sub_state ab cells[1], gibt die Anzahl belegter Zeichen zurück
+uint8_t paramValueCells(char* cells) {
+  Param p;
+  paramFetch(sub_state, p);
+  long value = state == 36 ? param_edit_value : paramGet(sub_state);
+  if (p.type == PARAM_BOOL) {
+    cells[1] = value ? 1 : 2;
+    return 1;
+  }
+  char digits[12];
+  ltoa(value, digits, 10);
+  uint8_t n = strlen(digits);
+  memcpy(cells + 1, digits, n);
+  return n;
+}
+
+bool screenField(uint8_t field, char* cells) {
+  switch (field) {
+    case FIELD_WEIGHT: { weightCells(current_weight_g - stateOffset(), cells); return true; }
+    case FIELD_DONE_WEIGHT: { weightCells(last_target_done_g, cells); return true; }
+    // beim Bearbeiten immer mit führender Null
+    case FIELD_TARGET: return formatWeight(stateTarget(), 1, cells, !stateEditsTarget());
+    case FIELD_LAST_TARGET: return formatWeight(last_target_g, 1, cells);
+    case FIELD_OFFSET: return formatWeight(stateOffset(), 2, cells);
+    case FIELD_PRESET: {
+      uint8_t preset = statePreset();
+      cells[0] = preset == 0 ? 2 : '0' + preset;
+      return true;
+    }
+    case FIELD_WARM: { cells[0] = loadcell_warm ? ' ' : 5; return true; }
+    case FIELD_CONTAINER: {
+      if (container_match >= 0) cells[0] = '1' + container_match;
+      else cells[0] = container_match == CONTAINER_AMBIGUOUS ? '?' : ' ';
+      return true;
+    }
+    case FIELD_TOPUP: {
+      if (!use_topup) return false;
+      textCells(TXT_TOPUP_LABEL, cells, 3);
+      formatPlaces(topup_cycles > 9999 ? 9999 : topup_cycles, fmt_decimal + 1, 4, cells + 3, 3);
+      cells[7] = topup_waiting ? 5 : ' ';
+      return true;
+    }
+    case FIELD_DURATION_MIN:
+    case FIELD_DURATION_SEC: {
+      if (t_last_target_duration >= 6000000) {
+        if (field == FIELD_DURATION_SEC) return false;
+        cells[0] = ' ';
+        cells[1] = 3;
+        return true;
+      }
+      // mm:ss, führende Nullen der Minuten und der Zehner-Sekunden als Leerzeichen
+      char digits[4];
+      formatPlaces(t_last_target_duration, fmt_duration_ms, 4, digits, 1);
+      if (digits[2] == '0') digits[2] = ' ';
+      uint8_t first = field == FIELD_DURATION_MIN ? 0 : 2;
+      cells[0] = digits[first];
+      cells[1] = digits[first + 1];
+      return true;
+    }
+    case FIELD_AUTOCYCLE: {
+      // Auto-Zyklus: Phase anstelle von "fertig" anzeigen
+      if (!use_autocycle) return false;
+      switch (autocycle_phase) {
+        case AUTOCYCLE_OFF:
+        case AUTOCYCLE_WAIT_REMOVAL: { textCells(TXT_AUTOCYCLE_DONE, cells, 6); break; }
+        case AUTOCYCLE_WAIT_CONTAINER: { textCells(TXT_AUTOCYCLE_WAITING, cells, 6); break; }
+        case AUTOCYCLE_CONFIRM: {
+          textCells(TXT_AUTOCYCLE_START, cells, 5);
+          // Restzeit in ganzen Sekunden, aufgerundet
+          uint32_t t_elapsed = millis() - t_autocycle_confirm_started;
+          formatPlaces(t_elapsed < t_autocycle_confirm ? t_autocycle_confirm - t_elapsed + 999 : 0, fmt_duration_ms + 3, 1, cells + 5);
+          break;
+        }
+      }
+      return true;
+    }
+    // bei verworfenem Punkt dessen Nummer
+    case FIELD_CAL_POINTS: { cells[0] = '0' + cal_points_count + cal_point_rejected; return true; }
+    case FIELD_CAL_POINT_STATUS: { textCells(cal_point_rejected ? TXT_CAL_POINT_REJECTED : TXT_CAL_POINT_DONE, cells, 8); return true; }
+    case FIELD_FAULT_CODE: {
+      if (loadcell_fault == FAULT_NONE) return false;
+      cells[0] = 'E';
+      cells[1] = '0' + loadcell_fault;
+      return true;
+    }
+    case FIELD_FAULT_TEXT: {
+      if (loadcell_fault == FAULT_NONE) return false;
+      textCells((TextId)(TXT_FAULT_TIMEOUT + loadcell_fault - FAULT_TIMEOUT), cells, 16);
+      return true;
+    }
+    case FIELD_DONE_STATUS: { cells[0] = settle_pending ? 5 : 1; return true; }
+    case FIELD_OVERSHOOT_HEAD: {
+      cells[0] = 0;
+      if (sub_state >= FLOW_PRESETS) {
+        memset(cells + 1, ' ', 15);
+        cells[1] = 4;
+        return true;
+      }
+      // "VE1 n  12^+0.35"
+      const OvershootStats& o = overshoot_stats[sub_state];
+      textCells(TXT_OVERSHOOT_HEAD, cells + 1, 15);
+      cells[3] = sub_state == 0 ? 2 : '0' + sub_state;
+      formatDecimal(o.count > 9999 ? 9999 : o.count, 4, cells + 6, 3);
+      if (o.count == 0) return true;
+      cells[11] = o.worst_g < 0 ? '-' : '+';
+      formatWeight(abs(o.worst_g), 2, cells + 12);
+      return true;
+    }
+    case FIELD_OVERSHOOT_STATS: {
+      // "M+0.12 s0.05  kg"
+      if (sub_state >= FLOW_PRESETS) {
+        memset(cells, ' ', 16);
+        return true;
+      }
+      const OvershootStats& o = overshoot_stats[sub_state];
+      textCells(TXT_OVERSHOOT_STATS, cells, 16);
+      if (o.count == 0) return true;
+      cells[1] = o.mean_g < 0 ? '-' : '+';
+      formatWeight(fabs(o.mean_g), 2, cells + 2);
+      formatWeight(overshootDeviation(o), 2, cells + 8);
+      return true;
+    }
+    case FIELD_RECIPE_ENTRY: {
+      cells[0] = 0;
+      if (sub_state >= RECIPE_COUNT) {
+        memset(cells + 1, ' ', 15);
+        cells[1] = 4;
+      } else {
+        // "Rezept n (m S.)"
+        textCells(TXT_RECIPE_ENTRY, cells + 1, 15);
+        cells[8] = '1' + sub_state;
+        cells[11] = '0' + recipe.count;
+      }
+      return true;
+    }
+    case FIELD_RECIPE_STEP: { cells[0] = '1' + recipe_step; return true; }
+    case FIELD_RECIPE_COUNT: { cells[0] = '0' + recipe.count; return true; }
+    case FIELD_RECIPE_OUTPUT: { cells[0] = '1' + recipe.steps[recipe_step].output; return true; }
+    case FIELD_RECIPE_PHASE: {
+      textCells((TextId)(TXT_RECIPE_TARE + recipe_phase), cells, 6);
+      return true;
+    }
+    case FIELD_RECIPE_STATUS: { cells[0] = recipe_aborted ? 2 : 1; return true; }
+    case FIELD_RECIPE_VIEW_STEP: { cells[0] = '1' + sub_state; return true; }
+    case FIELD_RECIPE_VIEW_TARGET: return formatWeight(recipe.steps[sub_state].target_g, 1, cells);
+    case FIELD_RECIPE_VIEW_ACTUAL:
+    case FIELD_RECIPE_VIEW_ERROR: {
+      // nicht (fertig) dosierte Schritte nach einem Abbruch
+      if (sub_state >= recipe_step) {
+        memset(cells, ' ', 5);
+        cells[field == FIELD_RECIPE_VIEW_ERROR ? 4 : 3] = '-';
+        return true;
+      }
+      long actual_g = recipe_actual_g[sub_state];
+      if (field == FIELD_RECIPE_VIEW_ACTUAL) return formatWeight(actual_g < 0 ? 0 : actual_g, 1, cells);
+      long error_g = actual_g - (long)recipe.steps[sub_state].target_g;
+      cells[0] = error_g < 0 ? '-' : '+';
+      return formatWeight(labs(error_g), 2, cells + 1);
+    }
+    case FIELD_DEGRADED_AMOUNT: return formatWeight(degraded_amount_g, 1, cells);
+    case FIELD_DEGRADED_TIME: {
+      uint32_t t_elapsed = millis() - t_degraded_started;
+      uint32_t t_left = output_enabled && t_elapsed < t_degraded_fill ? t_degraded_fill - t_elapsed : t_degraded_fill;
+      formatDecimal((t_left + 999) / 1000, 4, cells, 3);
+      return true;
+    }
+    case FIELD_EDIT_OK: {
+      bool ok = state == 6 ? cal_known_mass_ok
+              : state == 15 ? p1_target_ok : state == 20 ? p2_target_ok : state == 25 ? p0_target_ok
+              : state == 16 ? p1_tara_offset_ok : p2_tara_offset_ok;
+      cells[0] = ok ? 1 : 4;
+      return true;
+    }
+    case FIELD_KNOWN_MASS: {
+      char digits[4];
+      formatPlaces(cal_known_mass_g, fmt_decimal, 4, digits);
+      cells[0] = digits[0];
+      cells[1] = digits[1];
+      cells[2] = '.';
+      cells[3] = digits[2];
+      cells[4] = digits[3];
+      return true;
+    }
+    case FIELD_NOISE_COUNT: { formatPlaces(noise.count, fmt_decimal + 1, 4, cells, 3); return true; }
+    case FIELD_NOISE_ENOB: {
+      char digits[3];
+      formatDecimal(noisetest_enob * 10, 3, digits, 1);
+      cells[0] = digits[0];
+      cells[1] = digits[1];
+      cells[2] = '.';
+      cells[3] = digits[2];
+      return true;
+    }
+    case FIELD_NOISE_SD: {
+      // bis 9,99 g "d.dd", darüber "dd.d", max. 99,9 g
+      char digits[3];
+      bool fine = noisetest_sd_g < 10;
+      formatDecimal(fine ? noisetest_sd_g * 100 : noisetest_sd_g > 99.9f ? 999 : noisetest_sd_g * 10, 3, digits);
+      cells[0] = digits[0];
+      cells[1] = fine ? '.' : digits[1];
+      cells[2] = fine ? digits[1] : '.';
+      cells[3] = digits[2];
+      return true;
+    }
+    case FIELD_NOISE_WINDOW: {
+      cells[0] = noisetest_window_ok ? 'N' : '!';
+      formatDecimal(noisetest_window, 2, cells + 1, 1);
+      return true;
+    }
+    case FIELD_SETTINGS_TOP:
+    case FIELD_SETTINGS_BOTTOM: { settingsRowCells(field - FIELD_SETTINGS_TOP, cells); return true; }
+    case FIELD_PARAM_NAME: {
+      memset(cells, ' ', SCREEN_COLS);
+      cells[0] = state == 35 ? 0 : ' ';
+      if (sub_state >= PARAM_COUNT) {
+        cells[1] = 4;
+        return true;
+      }
+      Param p;
+      paramFetch(sub_state, p);
+      uint8_t n = 1;
+      if (sub_state + 1 >= 10) cells[n++] = '0' + (sub_state + 1) / 10;
+      cells[n++] = '0' + (sub_state + 1) % 10;
+      n++;
+      for (uint8_t i = 0; i < PARAM_NAME_LENGTH && p.name[i] != '\0' && n < SCREEN_COLS; i++) cells[n++] = p.name[i];
+      return true;
+    }
+    case FIELD_PARAM_VALUE: {
+      memset(cells, ' ', SCREEN_COLS);
+      cells[0] = state == 36 ? 0 : ' ';
+      if (sub_state < PARAM_COUNT) paramValueCells(cells);
+      return true;
+    }
+  }
+  return false;
+}
+
+// blinkender Cursor auf der bearbeiteten Stelle
+uint8_t screenEditCursor() {
+  if (state == 6) {
+    const uint8_t columns[] = { 3, 4, 6, 7, 12 };
+    return SCREEN_POS(sub_state == 0 && use_direct_edit ? 7 : columns[sub_state], 1);
+  }
+  if (stateEditsTarget()) return SCREEN_POS(sub_state < 3 ? targetEditColumn(stateTarget(), sub_state) : 11, 0);
+  if (stateEditsOffset()) return SCREEN_POS(sub_state < 3 ? offsetEditColumn(stateOffset(), sub_state) : 15, 1);
+  if (state == 36) {
+    // auf der letzten Stelle des Werts
+    char cells[SCREEN_COLS];
+    return SCREEN_POS(paramValueCells(cells), 1);
+  }
+  return SCREEN_NO_CURSOR;
+}
+
+const ScreenItem layout_error[] PROGMEM = {
+  S_TEXT(0, 0, TXT_ERROR), S_FIELD(7, 0, FIELD_FAULT_CODE, 2), S_GLYPH(9, 0, 0), S_TEXT(10, 0, TXT_RESET),
+  S_FIELD(0, 1, FIELD_FAULT_TEXT, 16), S_END
+};
+const ScreenItem layout_unload[] PROGMEM = {
+  S_TEXT(0, 0, TXT_UNLOAD), S_TEXT(0, 1, TXT_TARE_HINT), S_GLYPH(8, 1, 0), S_TEXT(9, 1, TXT_NEXT), S_END
+};
+const ScreenItem layout_place_mass[] PROGMEM = {
+  S_TEXT(0, 0, TXT_PLACE_MASS), S_TEXT(0, 1, TXT_CAL_HINT), S_GLYPH(8, 1, 0), S_TEXT(9, 1, TXT_NEXT), S_END
+};
+const ScreenItem layout_wait[] PROGMEM = {
+  S_TEXT(0, 0, TXT_WAIT), S_END
+};
+const ScreenItem layout_cal_point[] PROGMEM = {
+  S_TEXT(0, 0, TXT_CAL_POINT), S_FIELD(6, 0, FIELD_CAL_POINTS, 1), S_FIELD(7, 0, FIELD_CAL_POINT_STATUS, 8),
+  S_TEXT(0, 1, TXT_CAL_MORE), S_CURSOR(1, 1, 0), S_CURSOR(8, 1, 1), S_END
+};
+const ScreenItem layout_save_cal[] PROGMEM = {
+  S_TEXT(0, 0, TXT_SAVE_CAL), S_TEXT(3, 1, TXT_YES_NO), S_CURSOR(2, 1, 1), S_CURSOR(9, 1, 0), S_END
+};
+const ScreenItem layout_save_tare[] PROGMEM = {
+  S_TEXT(0, 0, TXT_SAVE_TARE), S_TEXT(3, 1, TXT_YES_NO), S_CURSOR(2, 1, 1), S_CURSOR(9, 1, 0), S_END
+};
+const ScreenItem layout_known_mass[] PROGMEM = {
+  S_TEXT(0, 0, TXT_KNOWN_MASS), S_GLYPH(1, 1, 0), S_TEXT(8, 1, TXT_KG),
+  S_FIELD(3, 1, FIELD_KNOWN_MASS, 5), S_FIELD(12, 1, FIELD_EDIT_OK, 1), S_END
+};
+const ScreenItem layout_noise_running[] PROGMEM = {
+  S_TEXT(0, 0, TXT_NOISE_RUNNING), S_TEXT(0, 1, TXT_NOISE_HINT), S_FIELD(12, 0, FIELD_NOISE_COUNT, 4), S_END
+};
+const ScreenItem layout_noise_result[] PROGMEM = {
+  S_GLYPH(4, 0, 'b'), S_GLYPH(6, 0, 's'), S_GLYPH(11, 0, 'g'), S_TEXT(0, 1, TXT_NOISE_SAVE),
+  S_FIELD(0, 0, FIELD_NOISE_ENOB, 4), S_FIELD(7, 0, FIELD_NOISE_SD, 4), S_FIELD(13, 0, FIELD_NOISE_WINDOW, 3),
+  S_CURSOR(8, 1, 0), S_CURSOR(13, 1, 1), S_END
+};
+const ScreenItem layout_settings[] PROGMEM = {
+  S_FIELD(0, 0, FIELD_SETTINGS_TOP, 16), S_FIELD(0, 1, FIELD_SETTINGS_BOTTOM, 16), S_END
+};
+const ScreenItem layout_params[] PROGMEM = {
+  S_FIELD(0, 0, FIELD_PARAM_NAME, 16), S_FIELD(0, 1, FIELD_PARAM_VALUE, 16), S_END
+};
+const ScreenItem layout_reset[] PROGMEM = {
+  S_TEXT(0, 0, TXT_RESET_QUESTION), S_TEXT(0, 1, TXT_RESET_SURE), S_CURSOR(8, 1, 0), S_CURSOR(13, 1, 1), S_END
+};
+// 12 / 17: 0 Start, 1 Tara-Versatz, 2 Sollwert
+const ScreenItem layout_preset_idle[] PROGMEM = {
+  S_TEXT(0, 0, TXT_HEADER), S_FIELD(15, 0, FIELD_PRESET, 1), S_TEXT(0, 1, TXT_START_TV),
+  S_CURSOR(0, 0, 2), S_FIELD(1, 0, FIELD_WEIGHT, 5), S_FIELD(7, 0, FIELD_TARGET, 4), S_FIELD(12, 0, FIELD_WARM, 1),
+  S_CURSOR(1, 1, 0), S_CURSOR(8, 1, 1), S_FIELD(11, 1, FIELD_OFFSET, 4), S_END
+};
+// 22: 0 Start, 1 Einstellungen, 2 Sollwert
+const ScreenItem layout_idle[] PROGMEM = {
+  S_TEXT(0, 0, TXT_HEADER), S_GLYPH(15, 0, 2), S_TEXT(0, 1, TXT_START_SETTINGS),
+  S_CURSOR(0, 0, 2), S_FIELD(1, 0, FIELD_WEIGHT, 5), S_FIELD(7, 0, FIELD_TARGET, 4), S_FIELD(11, 0, FIELD_CONTAINER, 1),
+  S_FIELD(12, 0, FIELD_WARM, 1), S_CURSOR(1, 1, 0), S_CURSOR(9, 1, 1), S_END
+};
+// 15 / 20: Sollwert bearbeiten, 16 / 21: Tara-Versatz bearbeiten, Haken / Kreuz dahinter
+const ScreenItem layout_preset_edit_target[] PROGMEM = {
+  S_TEXT(0, 0, TXT_HEADER), S_FIELD(15, 0, FIELD_PRESET, 1), S_TEXT(0, 1, TXT_START_TV), S_GLYPH(0, 0, 0),
+  S_FIELD(1, 0, FIELD_WEIGHT, 5), S_FIELD(7, 0, FIELD_TARGET, 4), S_FIELD(11, 0, FIELD_EDIT_OK, 1),
+  S_FIELD(12, 0, FIELD_WARM, 1), S_FIELD(11, 1, FIELD_OFFSET, 4), S_END
+};
+const ScreenItem layout_preset_edit_offset[] PROGMEM = {
+  S_TEXT(0, 0, TXT_HEADER), S_FIELD(15, 0, FIELD_PRESET, 1), S_TEXT(0, 1, TXT_START_TV), S_GLYPH(8, 1, 0),
+  S_FIELD(1, 0, FIELD_WEIGHT, 5), S_FIELD(7, 0, FIELD_TARGET, 4), S_FIELD(12, 0, FIELD_WARM, 1),
+  S_FIELD(11, 1, FIELD_OFFSET, 4), S_FIELD(15, 1, FIELD_EDIT_OK, 1), S_END
+};
+// 25: Sollwert ohne VE bearbeiten
+const ScreenItem layout_edit_target[] PROGMEM = {
+  S_TEXT(0, 0, TXT_HEADER), S_GLYPH(15, 0, 2), S_TEXT(0, 1, TXT_START_SETTINGS), S_GLYPH(0, 0, 0),
+  S_FIELD(1, 0, FIELD_WEIGHT, 5), S_FIELD(7, 0, FIELD_TARGET, 4), S_FIELD(11, 0, FIELD_EDIT_OK, 1),
+  S_FIELD(12, 0, FIELD_WARM, 1), S_END
+};
+// 30: unterbrochene Befüllung fortsetzen, Werte aus dem Journal, 0 nein, 1 ja
+const ScreenItem layout_resume[] PROGMEM = {
+  S_TEXT(0, 0, TXT_HEADER), S_FIELD(15, 0, FIELD_PRESET, 1), S_TEXT(0, 1, TXT_RESUME_SURE),
+  S_FIELD(1, 0, FIELD_WEIGHT, 5), S_FIELD(7, 0, FIELD_TARGET, 4), S_FIELD(12, 0, FIELD_WARM, 1),
+  S_CURSOR(8, 1, 0), S_CURSOR(13, 1, 1), S_END
+};
+// 13 / 18 / 23
+const ScreenItem layout_active[] PROGMEM = {
+  S_TEXT(0, 0, TXT_HEADER), S_FIELD(15, 0, FIELD_PRESET, 1), S_TEXT(0, 1, TXT_ACTIVE), S_GLYPH(9, 1, 0),
+  S_FIELD(1, 0, FIELD_WEIGHT, 5), S_FIELD(7, 0, FIELD_TARGET, 4), S_FIELD(0, 1, FIELD_TOPUP, 8), S_END
+};
+// 14 / 19 / 24, der Unterzustand zählt hier die Ende-Musik, daher keine Cursor-Plätze
+const ScreenItem layout_done[] PROGMEM = {
+  S_TEXT(0, 0, TXT_HEADER), S_FIELD(15, 0, FIELD_PRESET, 1), S_FIELD(0, 0, FIELD_DONE_STATUS, 1), S_TEXT(0, 1, TXT_DONE),
+  S_GLYPH(9, 1, 0), S_FIELD(1, 0, FIELD_DONE_WEIGHT, 5), S_FIELD(7, 0, FIELD_LAST_TARGET, 4),
+  S_FIELD(0, 1, FIELD_DURATION_MIN, 2), S_FIELD(5, 1, FIELD_DURATION_SEC, 2), S_FIELD(10, 1, FIELD_AUTOCYCLE, 6), S_END
+};
+// 37 / 38: Notbetrieb, Start mit langem Klick
+const ScreenItem layout_degraded[] PROGMEM = {
+  S_TEXT(0, 0, TXT_DEGRADED), S_FIELD(15, 0, FIELD_PRESET, 1), S_TEXT(0, 1, TXT_DEGRADED_START), S_GLYPH(1, 1, 0),
+  S_FIELD(10, 1, FIELD_DEGRADED_AMOUNT, 4), S_END
+};
+const ScreenItem layout_degraded_active[] PROGMEM = {
+  S_TEXT(0, 0, TXT_DEGRADED), S_FIELD(15, 0, FIELD_PRESET, 1), S_TEXT(0, 1, TXT_DEGRADED_ACTIVE), S_GLYPH(9, 1, 0),
+  S_FIELD(0, 1, FIELD_DEGRADED_TIME, 4), S_END
+};
+// 43: Überschwing-Statistik je VE, langer Klick löscht
+const ScreenItem layout_overshoot[] PROGMEM = {
+  S_FIELD(0, 0, FIELD_OVERSHOOT_HEAD, 16), S_FIELD(0, 1, FIELD_OVERSHOOT_STATS, 16), S_END
+};
+// 39: Rezept wählen, Start mit langem Klick
+const ScreenItem layout_recipe_select[] PROGMEM = {
+  S_FIELD(0, 0, FIELD_RECIPE_ENTRY, 16), S_TEXT(0, 1, TXT_RECIPE_HINT), S_END
+};
+// 40: Rezept läuft
+const ScreenItem layout_recipe_active[] PROGMEM = {
+  S_TEXT(0, 0, TXT_RECIPE_HEADER), S_FIELD(13, 0, FIELD_RECIPE_STEP, 1), S_FIELD(15, 0, FIELD_RECIPE_COUNT, 1),
+  S_TEXT(0, 1, TXT_RECIPE_ACTIVE), S_GLYPH(9, 1, 0), S_FIELD(1, 0, FIELD_WEIGHT, 5), S_FIELD(7, 0, FIELD_TARGET, 4),
+  S_FIELD(1, 1, FIELD_RECIPE_OUTPUT, 1), S_FIELD(3, 1, FIELD_RECIPE_PHASE, 6), S_END
+};
+// 42: Ergebnis je Schritt, mit dem Drehknopf blättern
+const ScreenItem layout_recipe_done[] PROGMEM = {
+  S_TEXT(0, 0, TXT_RECIPE_RESULT_TARGET), S_TEXT(0, 1, TXT_RECIPE_RESULT_ACTUAL), S_FIELD(0, 0, FIELD_RECIPE_STATUS, 1),
+  S_FIELD(2, 0, FIELD_RECIPE_VIEW_STEP, 1), S_FIELD(9, 0, FIELD_RECIPE_VIEW_TARGET, 4),
+  S_FIELD(4, 1, FIELD_RECIPE_VIEW_ACTUAL, 4), S_FIELD(9, 1, FIELD_RECIPE_VIEW_ERROR, 5), S_END
+};
+
+struct ScreenLayoutEntry {
+  uint8_t state;
+  const ScreenItem* layout;
+};
+
+// Zustände ohne Eintrag haben keinen eigenen Bildschirm (Übergänge)
+const ScreenLayoutEntry screen_layouts[] PROGMEM = {
+  { 2, layout_error }, { 4, layout_unload }, { 9, layout_unload }, { 5, layout_place_mass },
+  { 7, layout_save_cal }, { 10, layout_save_tare }, { 62, layout_cal_point }, { 27, layout_reset },
+  { 29, layout_wait }, { 31, layout_wait }, { 41, layout_wait }, { 61, layout_wait }, { 91, layout_wait },
+  { 12, layout_preset_idle }, { 17, layout_preset_idle }, { 22, layout_idle },
+  { 13, layout_active }, { 18, layout_active }, { 23, layout_active },
+  { 14, layout_done }, { 19, layout_done }, { 24, layout_done },
+  { 37, layout_degraded }, { 38, layout_degraded_active },
+  { 39, layout_recipe_select }, { 40, layout_recipe_active }, { 42, layout_recipe_done },
+  { 43, layout_overshoot },
+  { 6, layout_known_mass }, { 15, layout_preset_edit_target }, { 20, layout_preset_edit_target },
+  { 16, layout_preset_edit_offset }, { 21, layout_preset_edit_offset }, { 25, layout_edit_target },
+  { 26, layout_settings }, { 30, layout_resume }, { 32, layout_noise_running }, { 33, layout_noise_result },
+  { 35, layout_params }, { 36, layout_params },
+};
+
+const ScreenItem* screen_layout = nullptr;    // Layout des aktuellen Zustands, nullptr = keins
+
+const ScreenItem* screenLayoutFor(uint8_t s) {
+  for (uint8_t i = 0; i < sizeof(screen_layouts) / sizeof(screen_layouts[0]); i++) {
+    if (pgm_read_byte(&screen_layouts[i].state) == s) return (const ScreenItem*)pgm_read_ptr(&screen_layouts[i].layout);
+  }
+  return nullptr;
+}
+
+void drawScreenForState(uint8_t targetState) {
+  lcd.noBlink();
+  const ScreenItem* layout = screenLayoutFor(targetState);
+  if (layout != nullptr) screenDraw(layout);
+  redraw_screen = true;
+}
+
+void stateTransition(uint8_t targetState, uint8_t targetSubState = 0) {
+  // Befüllung verlassen: Ausgang sofort aus, erst danach das Journal löschen (EEPROM-Schreibzeit)
+  if (output_enabled) disableOutput();
+  if (journal_active) journalClear();
+  curveFinish(true);
+  settle_pending = false;
+  state = targetState;
+  sub_state = targetSubState;
+  screen_layout = screenLayoutFor(targetState);
+  input_stop_latched = false;
+  autocycle_phase = AUTOCYCLE_OFF;
+  topup_waiting = false;
+
+  #ifdef SERIAL_ENABLED
+  Serial.print(txt(TXT_STATE_TRANSITION));
+  Serial.println(state);
+  #endif
+
+  switch (targetState) {
+    case 2: {
+      tone(PIN_BEEP, BEEP_FREQ_ERR, beep_length_err);
+    }
+    case 4:
+    case 5:
+    case 6:
+    case 7:
+    case 9:
+    case 10:
+    case 12:
+    case 13:
+    case 14:
+    case 17:
+    case 18:
+    case 19:
+    case 22:
+    case 23:
+    case 24:
+    case 26:
+    case 27:
+    case 29:
+    case 41:
+    case 30:
+    case 31:
+    case 32:
+    case 33:
+    case 35:
+    case 36:
+    case 37:
+    case 38:
+    case 39:
+    case 40:
+    case 42:
+    case 43:
+    case 61:
+    case 62:
+    case 91:
+    case 15:
+    case 16:
+    case 20:
+    case 21: {
+      drawScreenForState(targetState);
+      break;
+    }
+    case 25: {
+      p0_target_ok = true;
+      drawScreenForState(targetState);
+      break;
+    }
+  }
+}
+
+// Wert um step x factor ändern und auf [min_value, max_value] begrenzen
+void adjustValue(long* value, bool left, long step, uint8_t factor, long min_value, long max_value) {
+  long delta = step * factor;
+  if (left) *value = *value - delta < min_value ? min_value : *value - delta;
+  else *value = *value + delta > max_value ? max_value : *value + delta;
+}
+
+// Faktor aus der Beschleunigungskurve für den in der ISR gemessenen Abstand zur vorherigen
+// Rastung, nicht für den Zeitpunkt der Verarbeitung: nach einer blockierenden LCD- oder
+// EEPROM-Ausgabe kommen gestaute Rastungen sonst im Abstand von 1 ms und bekämen alle Faktor 50
+uint8_t encoderAccelFactor(uint8_t interval) {
+  for (uint8_t i = 0; i < sizeof(encoder_accel) / sizeof(encoder_accel[0]); i++) {
+    if (interval <= pgm_read_byte(&encoder_accel[i].max_interval_ms)) return pgm_read_byte(&encoder_accel[i].factor);
+  }
+  return 1;
+}
+
+void onTurn(bool left = false, uint8_t interval = 255) {
+  static bool beep;
+  static uint32_t t_last_beep = 0;
+  uint32_t t = millis();
+  uint8_t factor = encoderAccelFactor(interval);
+  beep = true;
+  redraw_screen = true;
+
+  switch (state) {
+    case 6: {
+      if (sub_state < 4) adjustValue(&cal_known_mass_g, left, use_direct_edit ? DIRECTEDIT_STEP_CALIB : pow10(4-sub_state), factor, MIN_WEIGHT_CALIB, MAX_WEIGHT_CALIB);
+      else cal_known_mass_ok = !cal_known_mass_ok;
+      break;
+    }
+    case 7: 
+    case 10:
+    case 27:
+    case 30:
+    case 33:
+    case 62: {
+      sub_state = (sub_state+1) % 2;
+      break;
+    }
+    case 12:
+    case 17:
+    case 22: {
+      sub_state = left ? (sub_state+2) % 3 : (sub_state+1) % 3;
+      break;
+    }
+    case 15: {
+      if (sub_state < 3) adjustValue(&p1_target_g, left, use_direct_edit ? directEditStep(p1_target_g, DIRECTEDIT_STEP_TARGET, FMT_WEIGHT_KILO_FROM) : editStep(targetEditFirst(p1_target_g), sub_state), factor, MIN_WEIGHT_SETPOINT, limit_target_max_g);
+      else p1_target_ok = !p1_target_ok;
+      break;
     }
     case 16: {
-      if (sub_state < 3) {
-        if (left) {
-          p1_tara_offset_g -= pow10(3-sub_state);
-          if (p1_tara_offset_g < MIN_WEIGHT_OFFSET) p1_tara_offset_g = MIN_WEIGHT_OFFSET;
-        } else {
-          p1_tara_offset_g += pow10(3-sub_state);
-          if (p1_tara_offset_g > MAX_WEIGHT_OFFSET) p1_tara_offset_g = MAX_WEIGHT_OFFSET;
-        }
-      } 
+      if (sub_state < 3) adjustValue(&p1_tara_offset_g, left, use_direct_edit ? directEditStep(p1_tara_offset_g, DIRECTEDIT_STEP_OFFSET, FMT_WEIGHT_DECI_FROM) : editStep(offsetEditFirst(p1_tara_offset_g), sub_state), factor, MIN_WEIGHT_OFFSET, limit_offset_max_g);
       else p1_tara_offset_ok = !p1_tara_offset_ok;
       break;
     }
     case 20: {
-      if (sub_state < 3) {
-        if (left) {
-          p2_target_g -= pow10(4-sub_state);
-          if (p2_target_g < MIN_WEIGHT_SETPOINT) p2_target_g = MIN_WEIGHT_SETPOINT;
-        } else {
-          p2_target_g += pow10(4-sub_state);
-          if (p2_target_g > MAX_WEIGHT_SETPOINT) p2_target_g = MAX_WEIGHT_SETPOINT;
-        }
-      } 
+      if (sub_state < 3) adjustValue(&p2_target_g, left, use_direct_edit ? directEditStep(p2_target_g, DIRECTEDIT_STEP_TARGET, FMT_WEIGHT_KILO_FROM) : editStep(targetEditFirst(p2_target_g), sub_state), factor, MIN_WEIGHT_SETPOINT, limit_target_max_g);
       else p2_target_ok = !p2_target_ok;
       break;
     }
     case 21: {
-      if (sub_state < 3) {
-        if (left) {
-          p2_tara_offset_g -= pow10(3-sub_state);
-          if (p2_tara_offset_g < MIN_WEIGHT_OFFSET) p2_tara_offset_g = MIN_WEIGHT_OFFSET;
-        } else {
-          p2_tara_offset_g += pow10(3-sub_state);
-          if (p2_tara_offset_g > MAX_WEIGHT_OFFSET) p2_tara_offset_g = MAX_WEIGHT_OFFSET;
-        }
-      } 
+      if (sub_state < 3) adjustValue(&p2_tara_offset_g, left, use_direct_edit ? directEditStep(p2_tara_offset_g, DIRECTEDIT_STEP_OFFSET, FMT_WEIGHT_DECI_FROM) : editStep(offsetEditFirst(p2_tara_offset_g), sub_state), factor, MIN_WEIGHT_OFFSET, limit_offset_max_g);
       else p2_tara_offset_ok = !p2_tara_offset_ok;
       break;
     }
     case 25: {
-      if (sub_state < 3) {
-        if (left) {
-          p0_target_g -= pow10(4-sub_state);
-          if (p0_target_g < MIN_WEIGHT_SETPOINT) p0_target_g = MIN_WEIGHT_SETPOINT;
-        } else {
-          p0_target_g += pow10(4-sub_state);
-          if (p0_target_g > MAX_WEIGHT_SETPOINT) p0_target_g = MAX_WEIGHT_SETPOINT;
-        }
-      } 
+      if (sub_state < 3) adjustValue(&p0_target_g, left, use_direct_edit ? directEditStep(p0_target_g, DIRECTEDIT_STEP_TARGET, FMT_WEIGHT_KILO_FROM) : editStep(targetEditFirst(p0_target_g), sub_state), factor, MIN_WEIGHT_SETPOINT, limit_target_max_g);
       else p0_target_ok = !p0_target_ok;
       break;
     }
+    case 39: {
+      // letzter Eintrag: zurück
+      sub_state = left ? (sub_state+RECIPE_COUNT) % (RECIPE_COUNT+1) : (sub_state+1) % (RECIPE_COUNT+1);
+      if (sub_state < RECIPE_COUNT) recipeLoad(sub_state);
+      break;
+    }
+    case 43: {
+      // letzter Eintrag: zurück
+      sub_state = left ? (sub_state+FLOW_PRESETS) % (FLOW_PRESETS+1) : (sub_state+1) % (FLOW_PRESETS+1);
+      break;
+    }
+    case 42: {
+      if (recipe.count > 0) sub_state = left ? (sub_state+recipe.count-1) % recipe.count : (sub_state+1) % recipe.count;
+      break;
+    }
+    case 35: {
+      // letzter Eintrag: zurück
+      sub_state = left ? (sub_state+PARAM_COUNT) % (PARAM_COUNT+1) : (sub_state+1) % (PARAM_COUNT+1);
+      break;
+    }
+    case 36: {
+      Param p;
+      paramFetch(sub_state, p);
+      adjustValue(&param_edit_value, left, p.step, factor, p.min_value, p.max_value);
+      break;
+    }
     case 26: {
-      sub_state = left ? (sub_state+5) % 6 : (sub_state+1) % 6;
+      sub_state = left ? (sub_state+SETTINGS_MENU_ENTRIES-1) % SETTINGS_MENU_ENTRIES : (sub_state+1) % SETTINGS_MENU_ENTRIES;
       break;
     }
     default: {
@@ -528,14 +2529,31 @@ void onTurn(bool left = false) {
     }
   }
 
-  if (beep && use_keytones) tone(PIN_BEEP, BEEP_FREQ_RIGHT, BEEP_LENGTH_TURN);
+  if (beep && use_keytones && t - t_last_beep >= BEEP_MIN_INTERVAL_TURN) {
+    t_last_beep = t;
+    tone(PIN_BEEP, BEEP_FREQ_RIGHT, beep_length_turn);
+  }
   
   #ifdef SERIAL_ENABLED
-  if (left) Serial.println("Rotary turned left.");
-  else Serial.println("Rotary turned right.");
+  if (left) Serial.println(txt(TXT_TURN_LEFT));
+  else Serial.println(txt(TXT_TURN_RIGHT));
   #endif
 }
 
+// nächste Eingabe-Position, ok_pos ist das Feld zum Bestätigen. Bei der Ganzwert-Eingabe
+// gibt es nur den Wert (Position 0) und das Bestätigungsfeld.
+uint8_t nextEditPosition(uint8_t pos, uint8_t ok_pos) {
+  if (use_direct_edit) return pos == 0 ? ok_pos : 0;
+  return pos >= ok_pos ? 0 : pos + 1;
+}
+
+// Rezept abbrechen (Klick oder Modbus-STOPP), bisher im laufenden Schritt dosierte Menge festhalten
+void recipeAbort() {
+  if (recipe_phase != RECIPE_TARE) recipe_actual_g[recipe_step++] = current_weight_g - recipe_tare_g;
+  recipe_aborted = true;
+  stateTransition(42);
+}
+
 void shortClick_enc(bool beep = true) {
   switch (state) {
     case 2: {
@@ -556,11 +2574,17 @@ void shortClick_enc(bool beep = true) {
       }
       else {
         cal_known_mass_ok = true;
-        sub_state = (sub_state+1) % 5;
+        sub_state = nextEditPosition(sub_state, 4);
         redraw_screen = true;
       }
       break;
     }
+    case 62: {
+      // weiteren Kalibrierpunkt erfassen oder Kalibrierung abschließen
+      if (sub_state == 0) stateTransition(5);
+      else stateTransition(7);
+      break;
+    }
     case 7: {
       if (sub_state == 1) stateTransition(71);
       else stateTransition(11);
@@ -629,7 +2653,7 @@ void shortClick_enc(bool beep = true) {
       if (sub_state == 3 && p1_target_ok) stateTransition(151);
       else {
         p1_target_ok = true;
-        sub_state = (sub_state+1) % 4;
+        sub_state = nextEditPosition(sub_state, 3);
         redraw_screen = true;
       }
       break;
@@ -638,7 +2662,7 @@ void shortClick_enc(bool beep = true) {
       if (sub_state == 3 && p1_tara_offset_ok) stateTransition(151);
       else {
         p1_tara_offset_ok = true;
-        sub_state = (sub_state+1) % 4;
+        sub_state = nextEditPosition(sub_state, 3);
         redraw_screen = true;
       }
       break;
@@ -647,7 +2671,7 @@ void shortClick_enc(bool beep = true) {
       if (sub_state == 3 && p2_target_ok) stateTransition(201);
       else {
         p2_target_ok = true;
-        sub_state = (sub_state+1) % 4;
+        sub_state = nextEditPosition(sub_state, 3);
         redraw_screen = true;
       }
       break;
@@ -656,7 +2680,7 @@ void shortClick_enc(bool beep = true) {
       if (sub_state == 3 && p2_tara_offset_ok) stateTransition(201);
       else {
         p2_tara_offset_ok = true;
-        sub_state = (sub_state+1) % 4;
+        sub_state = nextEditPosition(sub_state, 3);
         redraw_screen = true;
       }
       break;
@@ -683,7 +2707,7 @@ void shortClick_enc(bool beep = true) {
       if (sub_state == 3 && p0_target_ok) stateTransition(22);
       else {
         p0_target_ok = true;
-        sub_state = (sub_state+1) % 4;
+        sub_state = nextEditPosition(sub_state, 3);
         redraw_screen = true;
       }
       break;
@@ -716,6 +2740,47 @@ void shortClick_enc(bool beep = true) {
           stateTransition(27);
           break;
         }
+        case 6: {
+          stateTransition(28);
+          break;
+        }
+        case 7: {
+          use_autocycle = !use_autocycle;
+          redraw_screen = true;
+          break;
+        }
+        case 8: {
+          use_direct_edit = !use_direct_edit;
+          redraw_screen = true;
+          break;
+        }
+        case 9: {
+          use_topup = !use_topup;
+          redraw_screen = true;
+          break;
+        }
+        case 10: {
+          noiseTestBegin(millis());
+          stateTransition(32);
+          break;
+        }
+        case 11: {
+          stateTransition(35);
+          break;
+        }
+        case 12: {
+          stateTransition(28);
+          break;
+        }
+        case 13: {
+          recipeLoad(0);
+          stateTransition(39);
+          break;
+        }
+        case 14: {
+          stateTransition(43);
+          break;
+        }
       }
       break;
     }
@@ -724,16 +2789,75 @@ void shortClick_enc(bool beep = true) {
       else stateTransition(26);
       break;
     }
+    case 32: {
+      // Rauschtest abbrechen
+      stateTransition(26);
+      break;
+    }
+    case 35: {
+      if (sub_state >= PARAM_COUNT) stateTransition(26, 11);
+      else {
+        param_edit_value = paramGet(sub_state);
+        stateTransition(36, sub_state);
+      }
+      break;
+    }
+    case 36: {
+      paramSet(sub_state, param_edit_value);
+      #ifdef SERIAL_ENABLED
+      Serial.print(txt(TXT_PARAM_SAVED));
+      Serial.println(param_edit_value);
+      #endif
+      stateTransition(35, sub_state);
+      break;
+    }
+    case 33: {
+      if (sub_state == 1) stateTransition(34);
+      else stateTransition(26);
+      break;
+    }
+    case 30: {
+      if (sub_state == 1) stateTransition(31);
+      else {
+        journalClear();
+        stateTransition(11);
+      }
+      break;
+    }
+    case 38: {
+      // STOPP: Ausgang ist schon per Interrupt aus, beendet wird in taskState()
+      break;
+    }
+    case 39: {
+      // Rezepte starten nur mit langem Klick
+      if (sub_state >= RECIPE_COUNT) stateTransition(26, 13);
+      else beep = false;
+      break;
+    }
+    case 40: {
+      recipeAbort();
+      break;
+    }
+    case 42: {
+      stateTransition(11);
+      break;
+    }
+    case 43: {
+      // gelöscht wird nur mit langem Klick
+      if (sub_state >= FLOW_PRESETS) stateTransition(26, 14);
+      else beep = false;
+      break;
+    }
     default: {
       beep = false;
       break;
     }
   }
   
-  if (beep && use_keytones) tone(PIN_BEEP, BEEP_FREQ_CLICK, BEEP_LENGTH_SHORT);
+  if (beep && use_keytones) tone(PIN_BEEP, BEEP_FREQ_CLICK, beep_length_short);
   
   #ifdef SERIAL_ENABLED
-  Serial.println("Rotary button short click.");
+  Serial.println(txt(TXT_CLICK_SHORT));
   #endif
 }
 
@@ -752,7 +2876,12 @@ void longClick_enc() {
     case 18:
     case 19:
     case 23: 
-    case 24: {
+    case 24:
+    case 35:
+    case 36:
+    case 38:
+    case 40:
+    case 42: {
       // in diesen Fällen ist lang-Klick äquivalent zu kurz-Klick
       shortClick_enc(false);
       break;
@@ -764,7 +2893,7 @@ void longClick_enc() {
     }
     case 12: {
       if (sub_state == 0) {
-        if (current_weight_g - p1_tara_offset_g < p1_target_g) stateTransition(13);
+        if (loadcell_warm && current_weight_g - p1_tara_offset_g < p1_target_g) stateTransition(13);
         else beep_error = true;
       }
       break;
@@ -781,55 +2910,242 @@ void longClick_enc() {
     }
     case 17: {
       if (sub_state == 0) {
-        if (current_weight_g - p2_tara_offset_g < p2_target_g) stateTransition(18);
+        if (loadcell_warm && current_weight_g - p2_tara_offset_g < p2_target_g) stateTransition(18);
         else beep_error = true;
       }
       break;
     }
     case 22: {
       if (sub_state == 0) {
-        if (current_weight_g < p0_target_g) stateTransition(23);
+        if (loadcell_warm && containerStartAllowed()) stateTransition(23);
         else beep_error = true;
       }
       break;
     }
+    case 37: {
+      if (t_degraded_fill > 0) {
+        stateTransition(38);
+        t_degraded_started = millis();
+      }
+      else beep_error = true;
+      break;
+    }
+    case 39: {
+      if (sub_state >= RECIPE_COUNT) shortClick_enc(false);
+      else if (loadcell_warm && recipe.count > 0) {
+        recipe_step = 0;
+        recipe_phase = RECIPE_TARE;
+        recipe_aborted = false;
+        stateTransition(40);
+      }
+      else beep_error = true;
+      break;
+    }
+    case 43: {
+      if (sub_state >= FLOW_PRESETS) shortClick_enc(false);
+      else {
+        overshootClear(sub_state);
+        redraw_screen = true;
+      }
+      break;
+    }
     default: {
       beep = false;
       break;
     }
   }
   
-  if (beep_error && use_keytones) { tone(PIN_BEEP, BEEP_FREQ_ERR, BEEP_LENGTH_ERR); beep = false; }
-  if (beep && use_keytones) tone(PIN_BEEP, BEEP_FREQ_CLICK, BEEP_LENGTH_LONG);
+  if (beep_error && use_keytones) { tone(PIN_BEEP, BEEP_FREQ_ERR, beep_length_err); beep = false; }
+  if (beep && use_keytones) tone(PIN_BEEP, BEEP_FREQ_CLICK, beep_length_long);
   
   #ifdef SERIAL_ENABLED
-  Serial.println("Rotary button long click.");
+  Serial.println(txt(TXT_CLICK_LONG));
   #endif
 }
 
-// das ist nötig, um die Signaturen von CtrlBtn::CallbackFunction {aka void (*)()} zu erfüllen.
-void shortClick_enc() { shortClick_enc(true); }
-void onTurnRight() { onTurn(); }
-void onTurnLeft() { onTurn(true); }
+/*  =============================
+      Eingabe per Interrupt
+    ============================= */
 
-// Hardware aus Libraries
-CtrlEnc   encoder   (PIN_ENCODER_CLK, PIN_ENCODER_DAT, onTurnRight, onTurnLeft);
-CtrlBtn   btn_enc   (PIN_ENCODER_BTN, 20, nullptr, shortClick_enc, longClick_enc);
+// Die Pins von Dreh-Drück-Knopf und VE-Schalter liegen alle auf PORTD. Der Drehgeber wird
+// über ein einziges Lesen von PIND ausgewertet, damit beide Spuren zum selben Zeitpunkt gelten.
+static_assert(PIN_ENCODER_BTN == 2 && PIN_ENCODER_CLK == 3, "Knopf und CLK muessen an INT0/INT1 liegen");
+static_assert(PIN_ENCODER_DAT < 8 && PIN_SW_1 < 8 && PIN_SW_2 < 8, "Eingaenge muessen auf PORTD liegen");
+
+enum InputEvent : uint8_t {
+  EVENT_TURN_RIGHT = 1,
+  EVENT_TURN_LEFT,
+  EVENT_CLICK_SHORT,
+  EVENT_CLICK_LONG,
+};
+
+// Lock-freie Ereignis-Warteschlange: nur die ISRs schreiben head, nur die loop schreibt tail.
+// Da sich ISRs auf dem AVR nicht gegenseitig unterbrechen, gibt es genau einen Schreiber.
+#define INPUT_QUEUE_SIZE 16   // muss eine Zweierpotenz sein
+volatile uint8_t input_queue[INPUT_QUEUE_SIZE];
+volatile uint8_t input_queue_interval[INPUT_QUEUE_SIZE];   // Drehung: Abstand (ms) zur vorherigen Rastung
+volatile uint8_t input_queue_head = 0;
+volatile uint8_t input_queue_tail = 0;
+volatile uint8_t input_queue_dropped = 0;
+
+volatile uint8_t encoder_state = 0;
+uint8_t encoder_last_dir = 0;               // nur in den ISRs
+uint32_t t_encoder_detent = 0;              // nur in den ISRs
+volatile bool btn_pressed = false;
+volatile uint32_t t_btn_edge = 0;
+volatile uint32_t t_btn_pressed = 0;
+volatile bool sw_changed = false;
+volatile uint32_t t_sw_changed = 0;
+
+void inputPush(uint8_t event, uint8_t interval = 255) {
+  uint8_t next = (input_queue_head + 1) & (INPUT_QUEUE_SIZE - 1);
+  if (next == input_queue_tail) { input_queue_dropped++; return; }
+  input_queue[input_queue_head] = event;
+  input_queue_interval[input_queue_head] = interval;
+  input_queue_head = next;
+}
+
+bool inputPop(uint8_t& event, uint8_t& interval) {
+  if (input_queue_tail == input_queue_head) return false;
+  event = input_queue[input_queue_tail];
+  interval = input_queue_interval[input_queue_tail];
+  input_queue_tail = (input_queue_tail + 1) & (INPUT_QUEUE_SIZE - 1);
+  return true;
+}
+
+// Zustandstabelle für den Drehgeber (Vollschritt). Ungültige Übergänge durch Kontaktprellen
+// führen zurück in den Startzustand, ein Ereignis gibt es nur bei vollständig durchlaufener Rastung.
+#define ENC_START 0x0
+#define ENC_CW_FINAL 0x1
+#define ENC_CW_BEGIN 0x2
+#define ENC_CW_NEXT 0x3
+#define ENC_CCW_BEGIN 0x4
+#define ENC_CCW_FINAL 0x5
+#define ENC_CCW_NEXT 0x6
+#define ENC_DIR_CW 0x10
+#define ENC_DIR_CCW 0x20
+const uint8_t encoder_table[7][4] PROGMEM = {
+  { ENC_START,     ENC_CW_BEGIN,  ENC_CCW_BEGIN, ENC_START },                // ENC_START
+  { ENC_CW_NEXT,   ENC_START,     ENC_CW_FINAL,  ENC_START | ENC_DIR_CW },   // ENC_CW_FINAL
+  { ENC_CW_NEXT,   ENC_CW_BEGIN,  ENC_START,     ENC_START },                // ENC_CW_BEGIN
+  { ENC_CW_NEXT,   ENC_CW_BEGIN,  ENC_CW_FINAL,  ENC_START },                // ENC_CW_NEXT
+  { ENC_CCW_NEXT,  ENC_START,     ENC_CCW_BEGIN, ENC_START },                // ENC_CCW_BEGIN
+  { ENC_CCW_NEXT,  ENC_CCW_FINAL, ENC_START,     ENC_START | ENC_DIR_CCW },  // ENC_CCW_FINAL
+  { ENC_CCW_NEXT,  ENC_CCW_FINAL, ENC_CCW_BEGIN, ENC_START },                // ENC_CCW_NEXT
+};
+
+inline void encoderUpdate(uint8_t pins) {
+  uint8_t ab = ((pins >> PIN_ENCODER_CLK) & 1) << 1 | ((pins >> PIN_ENCODER_DAT) & 1);
+  uint8_t next = pgm_read_byte(&encoder_table[encoder_state & 0x0f][ab]);
+  encoder_state = next;
+  uint8_t dir = next & (ENC_DIR_CW | ENC_DIR_CCW);
+  if (!dir) return;
+  // Abstand zur vorherigen Rastung gleicher Richtung, Richtungswechsel zählt als langsam (255)
+  uint32_t t = millis();
+  uint32_t interval = dir == encoder_last_dir ? t - t_encoder_detent : 255;
+  encoder_last_dir = dir;
+  t_encoder_detent = t;
+  inputPush(dir == ENC_DIR_CW ? EVENT_TURN_RIGHT : EVENT_TURN_LEFT, interval > 255 ? 255 : interval);
+}
+
+// Auswertung einer Flanke des Knopfs, aufgerufen aus der ISR oder (gesperrt) aus der loop
+void buttonEdge(bool pressed, uint32_t t) {
+  if (pressed == btn_pressed) return;
+  btn_pressed = pressed;
+  t_btn_edge = t;
+  if (pressed) {
+    t_btn_pressed = t;
+    // STOPP während einer aktiven Dosierung: Ausgang sofort abschalten, Zustandswechsel folgt in der loop.
+    // output_enabled mit zurücksetzen, sonst hielte die Fehlerprüfung die stehende Waage bei
+    // gehaltenem Knopf für eingefroren (E5).
+    if (output_enabled) {
+      outputsLow();
+      output_enabled = false;
+      input_stop_latched = true;
+    }
+  } else {
+    inputPush(t - t_btn_pressed >= t_long_click ? EVENT_CLICK_LONG : EVENT_CLICK_SHORT);
+  }
+}
+
+// Knopf (Pin 2, LOW = gedrückt): erste Flanke zählt, danach Sperrzeit gegen Prellen
+ISR(INT0_vect) {
+  uint32_t t = millis();
+  if (t - t_btn_edge < t_debounce_button) return;
+  buttonEdge(!FastPin<PIN_ENCODER_BTN>::read(), t);
+}
+
+// Drehgeber CLK (Pin 3)
+ISR(INT1_vect) {
+  encoderUpdate(PIND);
+}
+
+// Drehgeber DAT (Pin 4) und VE-Schalter (Pins 5/7)
+ISR(PCINT2_vect) {
+  static uint8_t pins_pre = 0;
+  uint8_t pins = PIND;
+  uint8_t changed = pins ^ pins_pre;
+  pins_pre = pins;
+  if (changed & _BV(PIN_ENCODER_DAT)) encoderUpdate(pins);
+  if (changed & (_BV(PIN_SW_1) | _BV(PIN_SW_2))) {
+    t_sw_changed = millis();
+    sw_changed = true;
+  }
+}
+
+uint8_t readSwitchPosition() {
+  if (!Switch1Pin::read()) return 1;
+  else if (!Switch2Pin::read()) return 2;
+  else return 0;
+}
+
+void inputBegin() {
+  FastPin<PIN_ENCODER_CLK>::inputPullup();
+  FastPin<PIN_ENCODER_DAT>::inputPullup();
+  FastPin<PIN_ENCODER_BTN>::inputPullup();
+  sw_pos = readSwitchPosition();
+
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    EICRA = _BV(ISC00) | _BV(ISC10);    // INT0 und INT1 bei jeder Flanke
+    EIFR = _BV(INTF0) | _BV(INTF1);
+    EIMSK |= _BV(INT0) | _BV(INT1);
+    PCMSK2 |= _BV(PCINT20) | _BV(PCINT21) | _BV(PCINT23);
+    PCIFR = _BV(PCIF2);
+    PCICR |= _BV(PCIE2);
+  }
+}
+
+// Prellt der Knopf noch nach Ablauf der Sperrzeit, wird hier der tatsächliche Pegel nachgeführt,
+// damit z.B. ein sehr kurzer Klick nicht als "dauerhaft gedrückt" hängen bleibt.
+void inputService(uint32_t t) {
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    bool pressed = !FastPin<PIN_ENCODER_BTN>::read();
+    if (pressed != btn_pressed && t - t_btn_edge >= t_debounce_button) buttonEdge(pressed, t);
+  }
+}
 
 void setup() {
-  pinMode(PIN_SW_COM, OUTPUT);
-  pinMode(PIN_OUTPUT, OUTPUT);
-  pinMode(PIN_SW_1, INPUT_PULLUP);
-  pinMode(PIN_SW_2, INPUT_PULLUP);
-  digitalWrite(PIN_SW_COM, LOW);
-  digitalWrite(PIN_OUTPUT, LOW);
+  FastPin<PIN_SW_COM>::output();
+  OutputPin::output();
+  Output2Pin::output();
+  Output3Pin::output();
+  Switch1Pin::inputPullup();
+  Switch2Pin::inputPullup();
+  FastPin<PIN_SW_COM>::low();
+  outputsLow();
 
   
   #ifdef SERIAL_ENABLED
   Serial.begin(115200);
   delay(10);
   Serial.println();
-  Serial.println("Starting...");
+  Serial.println(txt(TXT_STARTING));
+  #endif
+
+  #ifdef MODBUS_ENABLED
+  uint8_t modbus_node = EEPROM.read(addr_modbus_address);
+  if (modbus_node == 0 || modbus_node > 247) modbus_node = DEFAULT_MODBUS_ADDRESS;
+  modbusBegin(modbus_node);
   #endif
 
   // Eigene Zeichen für das Display
@@ -838,6 +3154,7 @@ void setup() {
   uint8_t cross[8] = {0,0b10001,0b11011,0b01110,0b01110,0b11011,0b10001,0};
   uint8_t infty[8] = {0,0,0b01010,0b10101,0b10101,0b01010,0,0};
   uint8_t back[8] = {0b00100,0b01000,0b11110,0b01001,0b00101,0b00001,0b00110,0};
+  uint8_t hourglass[8] = {0b11111,0b10001,0b01010,0b00100,0b01110,0b11111,0b11111,0};
   // uint8_t up[8] = {0b00100,0b01110,0b11111,0,0,0,0,0};                                 // z.Zt. nicht benötigt
   // uint8_t down[8] = {0,0,0,0,0,0b11111,0b01110,0b00100};
 
@@ -848,18 +3165,21 @@ void setup() {
   lcd.createChar(2, cross);
   lcd.createChar(3, infty);
   lcd.createChar(4, back);
-  // lcd.createChar(5, up);
+  lcd.createChar(5, hourglass);
   // lcd.createChar(6, down);
+  screenBegin(&lcd);
+
+  inputBegin();
 
 
   // Startbildschirm
   lcd.clear();
   lcd.setCursor(0,0);
-  lcd.print(F(" Weight-O-Matic "));
+  lcd.print(txt(TXT_TITLE));
   lcd.setCursor(0,1);
-  lcd.print(VERSION);
+  lcd.print(txt(TXT_VERSION));
   lcd.setCursor(6,1);
-  lcd.print("Starte...");
+  lcd.print(txt(TXT_STARTING_LCD));
   lcd.setCursor(15,1);
   lcd.blink();
 
@@ -872,7 +3192,7 @@ void setup() {
     EEPROM.put(addr_tar_value, DEFAULT_TAR_OFFSET);
     EEPROM.write(addr_saved_flag, (uint8_t)169);
     #ifdef SERIAL_ENABLED
-    Serial.println(F("Keine Kalibrierungswerte im EEPROM gefunden, Standardwerte geladen!"));
+    Serial.println(txt(TXT_NO_CAL));
     #endif
   }
 
@@ -882,7 +3202,7 @@ void setup() {
     EEPROM.put(addr_toggle_settings, DEFAULT_TOGGLESETTINGS);
     EEPROM.write(addr_settings_saved_flag, (uint8_t)169);
     #ifdef SERIAL_ENABLED
-    Serial.println(F("Keine gespeicherten allg. Einstellungen im EEPROM gefunden, Standardwerte geladen!"));
+    Serial.println(txt(TXT_NO_SETTINGS));
     #endif
   }
 
@@ -893,213 +3213,775 @@ void setup() {
     EEPROM.put(addr_p1_offset, DEFAULT_P1_OFFSET);
     EEPROM.write(addr_p1_saved_flag, (uint8_t)169);
     #ifdef SERIAL_ENABLED
-    Serial.println(F("Keine gespeicherten Einstellungen für VE 1 im EEPROM gefunden, Standardwerte geladen!"));
+    Serial.println(txt(TXT_NO_P1));
+    #endif
+  }
+
+  // ...für Voreinstellung 2:
+  saved_flag = EEPROM.read(addr_p2_saved_flag);
+  if (saved_flag != 169) {
+    EEPROM.put(addr_p2_target, DEFAULT_P2_TARGET);
+    EEPROM.put(addr_p2_offset, DEFAULT_P2_OFFSET);
+    EEPROM.write(addr_p2_saved_flag, (uint8_t)169);
+    #ifdef SERIAL_ENABLED
+    Serial.println(txt(TXT_NO_P2));
+    #endif
+  }
+
+  /*  =============================
+        Übergang zu Zustand 1
+      ============================= */
+  stateTransition(1);
+
+  // Kalibrierungseinstellungen aus EEPROM laden
+  long tar_offset = 0;
+  float cal_value = 0.0f;
+  EEPROM.get(addr_tar_value, tar_offset);
+  EEPROM.get(addr_cal_value, cal_value);
+  loadcell.setTareOffset(tar_offset);
+  loadcell.setCalFactor(cal_value);
+  cal_points_count = 0;
+  if (EEPROM.read(addr_cal_points_saved_flag) == 169) {
+    uint8_t count = EEPROM.read(addr_cal_points_count);
+    if (count <= CAL_POINTS_MAX) {
+      cal_points_count = count;
+      for (uint8_t i = 0; i < count; i++) {
+        EEPROM.get(addr_cal_points + i*8, cal_knot_raw[i+1]);
+        EEPROM.get(addr_cal_points + i*8 + 4, cal_knot_mass_g[i+1]);
+      }
+    }
+  }
+  calibrationRebuild();
+  // Mittelwert-Fenster aus dem Rauschtest
+  uint8_t filter_window = EEPROM.read(addr_filter_window);
+  if (EEPROM.read(addr_filter_window_saved_flag) == 169 && filter_window >= 1 && filter_window <= HX711_SAMPLES) {
+    loadcell.setSamples(filter_window);
+  }
+  curveLoad();
+  flowLoad();
+  overshootLoad();
+  paramsLoad();
+  #ifdef SERIAL_ENABLED
+  Serial.print(txt(TXT_FILTER_LOADED));
+  Serial.println(loadcell.getSamples());
+  Serial.print(txt(TXT_CAL_LOADED));
+  Serial.print(tar_offset);
+  Serial.print(txt(TXT_SEPARATOR));
+  Serial.print(cal_value);
+  Serial.print(txt(TXT_SEPARATOR));
+  Serial.println(cal_points_count);
+  #endif
+
+  // allg. Einstellungen laden
+  uint8_t loaded_settings = 0;
+  EEPROM.get(addr_toggle_settings, loaded_settings);
+  setToggleSettingsFromBitvector(loaded_settings);
+  #ifdef SERIAL_ENABLED
+  Serial.print(txt(TXT_SETTINGS_LOADED));
+  Serial.println(loaded_settings, BIN);
+  #endif
+
+  // Einstellungen für VE 1 laden
+  EEPROM.get(addr_p1_target, p1_target_g);
+  EEPROM.get(addr_p1_offset, p1_tara_offset_g);
+  #ifdef SERIAL_ENABLED
+  Serial.println(txt(TXT_P1_LOADED));
+  #endif
+
+  // Einstellungen für VE 2 laden
+  EEPROM.get(addr_p2_target, p2_target_g);
+  EEPROM.get(addr_p2_offset, p2_tara_offset_g);
+  #ifdef SERIAL_ENABLED
+  Serial.println(txt(TXT_P2_LOADED));
+  #endif
+
+  // Wiegezelle initialisieren. Die Einschwingzeit läuft im Hintergrund (siehe pollLoadcell),
+  // bis dahin zeigt die Anzeige eine Sanduhr und START ist gesperrt. Kommt gar kein Messwert,
+  // greift der normale Timeout --> Zustand 2.
+  loadcell.begin();
+  t_last_weight_reading = millis();
+
+  // unterbrochene Befüllung im Journal? --> Fortsetzen anbieten
+  #ifdef SERIAL_ENABLED
+  if (reset_flags & _BV(BORF)) Serial.println(txt(TXT_BROWNOUT));
+  #endif
+  if (journalLoad()) {
+    #ifdef SERIAL_ENABLED
+    Serial.print(txt(TXT_JOURNAL_FOUND));
+    Serial.print(journal.preset);
+    Serial.print(txt(TXT_SEPARATOR));
+    Serial.print(journal.delivered_g);
+    Serial.print(txt(TXT_SEPARATOR));
+    Serial.println(journal.target_g);
+    #endif
+    stateTransition(30);
+    tasksStart();
+    return;
+  }
+
+  // Übergang zur loop, mit Zustand, der den Schalter ausliest
+  stateTransition(11);
+  tasksStart();
+}
+
+/*  =============================
+      Speicher-Überwachung
+    ============================= */
+
+#define STACK_CANARY 0xc5
+
+extern uint8_t _end;      // Ende von .data/.bss (vom Linker)
+extern uint8_t __stack;   // oberstes RAM-Byte (RAMEND)
+
+// Füllt beim Start den gesamten freien RAM zwischen .bss und Stack mit STACK_CANARY,
+// noch bevor Konstruktoren oder setup() laufen. Läuft ohne Stack, daher in Assembler.
+void paintStack() __attribute__((naked, used, section(".init3")));
+void paintStack() {
+  __asm volatile (
+    "    ldi r30, lo8(_end)\n"
+    "    ldi r31, hi8(_end)\n"
+    "    ldi r24, %0\n"
+    "    ldi r25, hi8(__stack)\n"
+    "    rjmp 2f\n"
+    "1:  st Z+, r24\n"
+    "2:  cpi r30, lo8(__stack)\n"
+    "    cpc r31, r25\n"
+    "    brlo 1b\n"
+    "    breq 1b\n"
+    :: "i" (STACK_CANARY)
+  );
+}
+
+// Anzahl Bytes oberhalb von .bss, die der Stack seit dem Start nie berührt hat
+uint16_t stackHeadroom() {
+  const uint8_t* p = &_end;
+  while (p <= &__stack && *p == STACK_CANARY) p++;
+  return p - &_end;
+}
+
+void printMemoryStats() {
+  #ifdef SERIAL_ENABLED
+  uint16_t ram_static = &_end - (uint8_t*)RAMSTART;
+  uint16_t headroom = stackHeadroom();
+  Serial.print(txt(TXT_RAM_STATIC));
+  Serial.println(ram_static);
+  Serial.print(txt(TXT_RAM_STACK_MAX));
+  Serial.println((uint16_t)(&__stack - &_end + 1) - headroom);
+  Serial.print(txt(TXT_RAM_FREE_MIN));
+  Serial.println(headroom);
+  Serial.print(txt(TXT_EEPROM_QUEUE_STATS));
+  Serial.print(eeprom_queue_stats.written);
+  Serial.print(txt(TXT_SEPARATOR));
+  Serial.print(eeprom_queue_stats.skipped);
+  Serial.print(txt(TXT_SEPARATOR));
+  Serial.println(eeprom_queue_stats.waits);
+  #endif
+}
+
+/*  =============================
+      Modbus RTU
+    ============================= */
+
+#ifdef MODBUS_ENABLED
+/*
+    Registerbelegung (Adressen ab 0, 32-Bit-Werte als zwei Register, höherwertiges Wort zuerst).
+    Gewichte in Gramm, Zeiten in ms.
+
+    Input-Register (FC 04, nur lesen):
+      0       Zustand (state)                     1       Unterzustand (sub_state)
+      2-3     Bruttogewicht                       4-5     Nettogewicht (abzgl. Tara-Versatz der VE bzw. des Behälters)
+      6       Status-Bits: 0 Ausgang an, 1 Stillstand, 2 eingeschwungen, 3 STOPP gedrückt, 4 Journal aktiv,
+              5 Nachfüllen eingeschaltet, 6 Nachfüllen wartet (Ventil zu), 7 Behälter nicht eindeutig,
+              8 Notbetrieb ohne Wiegezelle
+      7       VE-Wahl-Schalter (0 = keine, 1 / 2)
+      8-9     letzte Befüllung: Sollwert           10-11   letzte Befüllung: erreicht
+      12-13   letzte Befüllung: Dauer             14-15   Anzahl Befüllungen seit dem Start
+      16      Modbus: gültige Frames              17      Modbus: CRC-Fehler
+      18      Modbus: Rahmen-/Timing-Fehler       19      Modbus: gesendete Exceptions
+      20-21   Nachfüll-Zyklen seit dem Start      22      Fehlercode der Wiegezelle (0 = ok, siehe LoadcellFault)
+
+    Holding-Register (FC 03 / 06 / 16):
+      0-1     VE 1 Sollwert                       2-3     VE 1 Tara-Versatz
+      4-5     VE 2 Sollwert                       6-7     VE 2 Tara-Versatz
+      8-9     Sollwert ohne VE
+      10      Befehl (liest 0): 1 START, 2 STOPP, 3 Voreinstellungen ins EEPROM speichern
+      11      Knotenadresse 1-247, wird im EEPROM gespeichert und gilt nach der Antwort
+
+    Ein 32-Bit-Wert wird erst mit dem niederwertigen Register übernommen und geprüft (außerhalb
+    des Bereichs: Exception 03). Mit FC 06 also erst das höherwertige, dann das niederwertige Wort
+    schreiben. START ist nur in den Zuständen 12/17/22 nach dem Einschwingen und unterhalb des
+    Sollwerts möglich, STOPP nur während einer Befüllung, sonst Exception 04.
+ */
+
+static uint16_t modbus_write_high = 0;
+
+static uint16_t modbusHighWord(long value) { return (uint32_t)value >> 16; }
+
+uint8_t modbusReadRegister(bool input, uint16_t address, uint16_t* value) {
+  long v;
+  if (input) {
+    switch (address) {
+      case 0:  { *value = state; return 0; }
+      case 1:  { *value = sub_state; return 0; }
+      case 2:
+      case 3:  { v = current_weight_g; break; }
+      case 4:
+      case 5:  {
+        v = current_weight_g;
+        if (sw_pos == 1) v -= p1_tara_offset_g;
+        else if (sw_pos == 2) v -= p2_tara_offset_g;
+        else v -= p0_tara_offset_g;
+        break;
+      }
+      case 6:  {
+        *value = output_enabled | weight_stable << 1 | loadcell_warm << 2 | input_stop_latched << 3 | journal_active << 4
+               | use_topup << 5 | topup_waiting << 6 | (container_match == CONTAINER_AMBIGUOUS) << 7
+               | (state == 37 || state == 38) << 8;
+        return 0;
+      }
+      case 7:  { *value = sw_pos; return 0; }
+      case 8:
+      case 9:  { v = last_target_g; break; }
+      case 10:
+      case 11: { v = last_target_done_g; break; }
+      case 12:
+      case 13: { v = t_last_target_duration; break; }
+      case 14:
+      case 15: { v = fill_count; break; }
+      case 16: { *value = modbus_counters.frames; return 0; }
+      case 17: { *value = modbus_counters.crc_errors; return 0; }
+      case 18: { *value = modbus_counters.frame_errors; return 0; }
+      case 19: { *value = modbus_counters.exceptions; return 0; }
+      case 20:
+      case 21: { v = topup_cycles; break; }
+      case 22: { *value = loadcell_fault; return 0; }
+      default: return MODBUS_EX_ILLEGAL_ADDRESS;
+    }
+  } else {
+    switch (address) {
+      case 0:
+      case 1:  { v = p1_target_g; break; }
+      case 2:
+      case 3:  { v = p1_tara_offset_g; break; }
+      case 4:
+      case 5:  { v = p2_target_g; break; }
+      case 6:
+      case 7:  { v = p2_tara_offset_g; break; }
+      case 8:
+      case 9:  { v = p0_target_g; break; }
+      case 10: { *value = 0; return 0; }
+      case 11: { *value = modbus_address; return 0; }
+      default: return MODBUS_EX_ILLEGAL_ADDRESS;
+    }
+  }
+  *value = address & 1 ? (uint16_t)v : modbusHighWord(v);
+  return 0;
+}
+
+static uint8_t modbusCommand(uint16_t command) {
+  switch (command) {
+    case 1: {
+      // wie langer Klick auf START
+      if (!loadcell_warm) return MODBUS_EX_DEVICE_FAILURE;
+      if (state == 12 && current_weight_g - p1_tara_offset_g < p1_target_g) stateTransition(13);
+      else if (state == 17 && current_weight_g - p2_tara_offset_g < p2_target_g) stateTransition(18);
+      else if (state == 22 && containerStartAllowed()) stateTransition(23);
+      else return MODBUS_EX_DEVICE_FAILURE;
+      return 0;
+    }
+    case 2: {
+      // wie Klick während der Befüllung
+      if (state == 38) {
+        disableOutput();
+        input_stop_latched = true;
+        return 0;
+      }
+      if (state == 40) {
+        recipeAbort();
+        return 0;
+      }
+      if (state != 13 && state != 18 && state != 23) return MODBUS_EX_DEVICE_FAILURE;
+      disableOutput();
+      // WARNUNG: Rechenoperation mit state!
+      stateTransition(state+1);
+      return 0;
+    }
+    case 3: {
+      eepromQueuePut(addr_p1_target, p1_target_g);
+      eepromQueuePut(addr_p1_offset, p1_tara_offset_g);
+      eepromQueuePut(addr_p1_saved_flag, (uint8_t)169);
+      eepromQueuePut(addr_p2_target, p2_target_g);
+      eepromQueuePut(addr_p2_offset, p2_tara_offset_g);
+      eepromQueuePut(addr_p2_saved_flag, (uint8_t)169);
+      return 0;
+    }
+  }
+  return MODBUS_EX_ILLEGAL_VALUE;
+}
+
+// 32-Bit-Wert aus gemerktem höherwertigem Wort und neuem niederwertigem Wort übernehmen
+static uint8_t modbusWriteLong(long* target, uint16_t low, long min_value, long max_value) {
+  long v = (long)((uint32_t)modbus_write_high << 16 | low);
+  if (v < min_value || v > max_value) return MODBUS_EX_ILLEGAL_VALUE;
+  *target = v;
+  redraw_screen = true;
+  return 0;
+}
+
+uint8_t modbusWriteRegister(uint16_t address, uint16_t value) {
+  if (address <= 9 && !(address & 1)) {
+    modbus_write_high = value;
+    return 0;
+  }
+  switch (address) {
+    case 1:  return modbusWriteLong(&p1_target_g, value, MIN_WEIGHT_SETPOINT, limit_target_max_g);
+    case 3:  return modbusWriteLong(&p1_tara_offset_g, value, MIN_WEIGHT_OFFSET, limit_offset_max_g);
+    case 5:  return modbusWriteLong(&p2_target_g, value, MIN_WEIGHT_SETPOINT, limit_target_max_g);
+    case 7:  return modbusWriteLong(&p2_tara_offset_g, value, MIN_WEIGHT_OFFSET, limit_offset_max_g);
+    case 9:  return modbusWriteLong(&p0_target_g, value, MIN_WEIGHT_SETPOINT, limit_target_max_g);
+    case 10: return modbusCommand(value);
+    case 11: {
+      if (value == 0 || value > 247) return MODBUS_EX_ILLEGAL_VALUE;
+      eepromQueuePut(addr_modbus_address, (uint8_t)value);
+      modbus_address = value;
+      return 0;
+    }
+  }
+  return MODBUS_EX_ILLEGAL_ADDRESS;
+}
+#endif
+
+
+/*  =============================
+      Kooperativer Scheduler
+    ============================= */
+
+// Prioritäten der Tasks: kleinerer Index = höhere Priorität. Die Regelung läuft nicht periodisch, 
+// sondern immer sofort, wenn ein neuer Messwert der Wiegezelle vorliegt.
+enum TaskId : uint8_t {
+  TASK_CONTROL = 0,   // Regelung der aktiven Zustände 13/18/23, nur bei neuem Messwert
+  TASK_STATE,         // Verarbeitung der übrigen Zustände
+  TASK_INPUT,         // Dreh-Drück-Knopf
+  TASK_SWITCH,        // VE-Wahl-Schalter
+  TASK_DISPLAY,       // Bildschirm-Aktualisierung
+  TASK_AUDIO,         // Ende-Melodie
+  TASK_LOG,           // Laufzeit-Statistik über Serielle Konsole
+  TASK_SERIAL,        // Befehle über Serielle Konsole
+  TASK_MODBUS,        // Modbus-RTU-Anfragen
+  TASK_COUNT
+};
+
+struct Task {
+  void (*run)(uint32_t t);
+  uint16_t period_ms;         // 0 = in jedem Durchlauf
+  uint16_t deadline_ms;       // max. zulässige Verspätung ggü. dem geplanten Start
+  uint32_t t_due;             // geplanter Start (bei TASK_CONTROL: letzte Abfrage vor dem Messwert)
+  uint16_t overruns;          // Anzahl Fristüberschreitungen
+  uint16_t max_runtime_us;    // längste gemessene Laufzeit
+};
+extern Task tasks[TASK_COUNT];
+
+// Stillstand: Gewicht bleibt mind. t_stable innerhalb ±stable_band_g um einen Referenzwert
+void updateStability(uint32_t t) {
+  if (labs(current_weight_g - stable_reference_g) > stable_band_g) {
+    stable_reference_g = current_weight_g;
+    t_stable_since = t;
+    weight_stable = false;
+  }
+  else if (t - t_stable_since >= t_stable) weight_stable = true;
+}
+
+// Messwert aus Wiegezelle abholen. Gibt true zurück, wenn ein neuer Messwert vorliegt.
+// Wiegezelle ausgefallen: Notbetrieb, wenn eingeschaltet, in einem Hauptzustand und für die VE
+// eine Füllrate gelernt ist, sonst Fehlerzustand
+void loadcellFailed() {
+  bool filling = state == 13 || state == 18 || state == 23;
+  bool main_state = filling || state == 12 || state == 14 || state == 17 || state == 19 || state == 22 || state == 24;
+  // in Zustand 11 erst die Schalterstellung auswerten lassen
+  if (use_degraded && state == 11) return;
+  if (main_state && degradedAvailable(statePreset())) {
+    if (filling) disableOutput();
+    degradedPrepare(statePreset(), filling ? last_target_done_g : 0);
+    #ifdef SERIAL_ENABLED
+    Serial.print(txt(TXT_DEGRADED_ENTER));
+    Serial.print(degraded_preset);
+    Serial.print(txt(TXT_SEPARATOR));
+    Serial.print(degraded_amount_g);
+    Serial.print(txt(TXT_SEPARATOR));
+    Serial.println(t_degraded_fill);
     #endif
+    stateTransition(37);
   }
+  else stateTransition(2);
+}
 
-  // ...für Voreinstellung 2:
-  saved_flag = EEPROM.read(addr_p2_saved_flag);
-  if (saved_flag != 169) {
-    EEPROM.put(addr_p2_target, DEFAULT_P2_TARGET);
-    EEPROM.put(addr_p2_offset, DEFAULT_P2_OFFSET);
-    EEPROM.write(addr_p2_saved_flag, (uint8_t)169);
+bool pollLoadcell(uint32_t t) {
+  static long loadcell_reading = 0;
+
+  // Frist der Regelung: solange der HX711 noch wandelt, rückt sie mit jeder Abfrage nach. Der
+  // Messwert wurde also frühestens bei der letzten Abfrage ohne Messwert fertig, von dort an
+  // zählt die Verspätung (inkl. der Tasks, die seitdem gelaufen sind).
+  if (!loadcell.isReady()) tasks[TASK_CONTROL].t_due = t;
+  if (loadcell.update()) {
+    if (state == 2) return false;
+    LoadcellFault fault = loadcellCheck(loadcell.getRawData(), t);
+    if (fault != FAULT_NONE) {
+      if (state == 37 || state == 38) return false;
+      loadcell_fault = fault;
+      disableOutput();
+      #ifdef SERIAL_ENABLED
+      Serial.print(txt(TXT_LOADCELL_FAULT));
+      Serial.print(fault);
+      Serial.print(txt(TXT_SEPARATOR));
+      Serial.println(loadcell.getRawData());
+      #endif
+      stateTransition(2);
+      return false;
+    }
+    t_last_weight_reading = t;
+    captureSample(loadcell.getRawData(), t);
+    if (state == 37 || state == 38) {
+      loadcell_fault = FAULT_NONE;
+      // Messwerte wieder da: Notbetrieb beenden, erneut einschwingen lassen
+      disableOutput();
+      loadcell_warm = false;
+      #ifdef SERIAL_ENABLED
+      Serial.println(txt(TXT_DEGRADED_END));
+      #endif
+      stateTransition(11);
+    }
+    loadcell_reading = calibratedMass(loadcell.getSmoothedData() - loadcell.getTareOffset());
+    if (current_weight_g != loadcell_reading) {
+      current_weight_g = loadcell_reading;
+      redraw_screen = true;
+    }
+    updateStability(t);
+    // Einschwingen: erst wenn der Mittelwert-Puffer voll ist, zählt die Stabilitätszeit
+    if (!loadcell_warm) {
+      if (!loadcell.isFilled()) t_stable_since = t;
+      else if (weight_stable) {
+        loadcell_warm = true;
+        redraw_screen = true;
+        #ifdef SERIAL_ENABLED
+        Serial.println(txt(TXT_HX711_OK));
+        #endif
+      }
+    }
+    return true;
+  }
+
+  // wenn zu lange kein Messwert mehr gelesen wurde --> Fehlerzustand
+  if (t - t_last_weight_reading > t_timeout_weight_reading && state != 2 && state != 37 && state != 38) {
     #ifdef SERIAL_ENABLED
-    Serial.println(F("Keine gespeicherten Einstellungen für VE 2 im EEPROM gefunden, Standardwerte geladen!"));
+    Serial.println(txt(TXT_HX711_ERROR));
     #endif
+    loadcell_fault = FAULT_TIMEOUT;
+    loadcellFailed();
   }
+  return false;
+}
 
-  /*  =============================
-        Übergang zu Zustand 1
-      ============================= */
-  stateTransition(1);
+// Auto-Zyklus in den Zuständen 14 / 19 / 24, nur nach Erreichen des Sollwerts (nicht nach
+// STOPP): erst muss der volle Behälter entnommen werden (Waage stabil leer bzw. unter dem
+// Tara-Versatz abzgl. Band), dann ein leerer aufgestellt werden (stabil im Band um den
+// Tara-Versatz). Bleibt das für t_autocycle_confirm so, startet die nächste Befüllung.
+void autoCycle(uint32_t t, long offset_g, long target_g) {
+  if (!use_autocycle) return;
 
-  // Kalibrierungseinstellungen aus EEPROM laden
-  long tar_offset = 0;
-  float cal_value = 0.0f;
-  EEPROM.get(addr_tar_value, tar_offset);
-  EEPROM.get(addr_cal_value, cal_value);
-  loadcell.setTareOffset(tar_offset);
-  #ifdef SERIAL_ENABLED
-  Serial.print(F("Kalibrierungswerte aus EEPROM erfolgreich geladen: "));
-  Serial.print(tar_offset);
-  Serial.print(F(" / "));
-  Serial.println(cal_value);
-  #endif
+  bool container_placed = offset_g > 0 
+    ? labs(current_weight_g - offset_g) <= autocycle_tare_band_g
+    : current_weight_g >= AUTOCYCLE_MIN_CONTAINER_G && current_weight_g < target_g / 2;
 
-  // allg. Einstellungen laden
-  uint8_t loaded_settings = 0;
-  EEPROM.get(addr_toggle_settings, loaded_settings);
-  setToggleSettingsFromBitvector(loaded_settings);
-  #ifdef SERIAL_ENABLED
-  Serial.print(F("Gespeicherte allg. Einstellungen erfolgreich geladen: "));
-  Serial.println(loaded_settings, BIN);
-  #endif
+  bool container_removed = current_weight_g < AUTOCYCLE_MIN_CONTAINER_G
+    || (offset_g > 0 && current_weight_g < offset_g - (long)autocycle_tare_band_g);
 
-  // Einstellungen für VE 1 laden
-  EEPROM.get(addr_p1_target, p1_target_g);
-  EEPROM.get(addr_p1_offset, p1_tara_offset_g);
+  switch (autocycle_phase) {
+    case AUTOCYCLE_OFF: break;
+    case AUTOCYCLE_WAIT_REMOVAL: {
+      if (weight_stable && container_removed) {
+        autocycle_phase = AUTOCYCLE_WAIT_CONTAINER;
+        redraw_screen = true;
+      }
+      break;
+    }
+    case AUTOCYCLE_WAIT_CONTAINER: {
+      if (weight_stable && container_placed) {
+        autocycle_phase = AUTOCYCLE_CONFIRM;
+        t_autocycle_confirm_started = t;
+        redraw_screen = true;
+      }
+      break;
+    }
+    case AUTOCYCLE_CONFIRM: {
+      redraw_screen = true;
+      if (!weight_stable || !container_placed) autocycle_phase = AUTOCYCLE_WAIT_CONTAINER;
+      else if (t - t_autocycle_confirm_started >= t_autocycle_confirm) {
+        #ifdef SERIAL_ENABLED
+        Serial.println(txt(TXT_AUTOCYCLE_STARTED));
+        #endif
+        if (use_keytones) tone(PIN_BEEP, BEEP_FREQ_CLICK, beep_length_long);
+        // WARNUNG: Rechenoperation mit state!
+        stateTransition(state-1);
+      }
+      break;
+    }
+  }
+}
+
+// Nachfüllen: Sollwert erreicht, Ventil schließen und im aktiven Zustand bleiben
+void topupCycleDone(uint32_t t, long net_g) {
+  disableOutput();
+  journalClear();
+  curveFinish(false);
+  topup_cycles++;
+  topup_waiting = true;
+  t_topup_closed = t;
+  redraw_screen = true;
   #ifdef SERIAL_ENABLED
-  Serial.println(F("Gespeicherte Einstellungen für VE 1 erfolgreich geladen!"));
+  Serial.print(txt(TXT_TOPUP_CYCLE));
+  Serial.print(topup_cycles);
+  Serial.print(txt(TXT_SEPARATOR));
+  Serial.print(net_g);
+  Serial.print(txt(TXT_SEPARATOR));
+  Serial.println(t_last_target_duration);
   #endif
+}
 
-  // Einstellungen für VE 2 laden
-  EEPROM.get(addr_p2_target, p2_target_g);
-  EEPROM.get(addr_p2_offset, p2_tara_offset_g);
+// Nachfüllen: erneut öffnen erst unterhalb der Hysterese und nach der Mindest-Pausenzeit, und nur
+// solange der Behälter noch auf der Waage steht (sonst liefe das Ventil auf die leere Waage)
+bool topupMayReopen(uint32_t t, long net_g, long target_g, long offset_g) {
+  if (!topup_waiting) return true;
+  if (net_g >= target_g - target_g * topup_hysteresis_percent / 100) return false;
+  if (current_weight_g < offset_g + AUTOCYCLE_MIN_CONTAINER_G) return false;
+  if (t - t_topup_closed < t_topup_min_off) return false;
+  topup_waiting = false;
+  redraw_screen = true;
   #ifdef SERIAL_ENABLED
-  Serial.println(F("Gespeicherte Einstellungen für VE 2 erfolgreich geladen!"));
+  Serial.println(txt(TXT_TOPUP_REOPEN));
   #endif
+  return true;
+}
 
-  // Wiegezelle initialisieren - 2000ms Startzeit auf Empfehlung der Library
-  loadcell.begin();
-  loadcell.start(2000, false);
-
-  // Prüfen ob eine Verbindung zur Wiegezelle besteht
-  if (loadcell.getTareTimeoutFlag() || loadcell.getSignalTimeoutFlag()) {
-    #ifdef SERIAL_ENABLED
-    Serial.println(F("Fehler bei der Verbindung MCU <-> HX711."));
-    #endif
-    stateTransition(2);
-    return;
+// Gemeinsame Regelung für die aktiven Zustände 13 / 18 / 23
+void controlFill(uint32_t t, long net_g, long target_g, uint8_t preset, long offset_g) {
+  last_target_done_g = net_g;
+  if (output_enabled) t_last_target_duration = t - t_last_target_started;
+  curveSample(t, net_g);
+  // WARNUNG: Rechenoperation mit state!
+  if (net_g >= target_g) {
+    if (use_topup) {
+      if (output_enabled) {
+        uint32_t t_off = millis();
+        topupCycleDone(t, net_g);
+        captureTrigger(preset, target_g, t_off);
+      }
+    } else {
+      uint32_t t_off = millis();
+      disableOutput();
+      captureTrigger(preset, target_g, t_off);
+      fill_count++;
+      curveFinish(false);
+      flowLearn(preset, net_g - fill_start_net_g, t_last_target_duration);
+      stateTransition(state+1, 1);
+      autocycle_phase = AUTOCYCLE_WAIT_REMOVAL;
+      settleStart(t, preset, net_g);
+    }
   }
-  else {
-    loadcell.setCalFactor(cal_value);
-    #ifdef SERIAL_ENABLED
-    Serial.println(F("Wiegezelle erfolgreich initialisiert."));
-    #endif
+  else if (!output_enabled && !input_stop_latched) {
+    // neue Befüllung (nicht erneutes Öffnen beim Nachfüllen): Zyklen neu zählen
+    bool reopen = use_topup && topup_waiting;
+    if (use_topup && !topupMayReopen(t, net_g, target_g, offset_g)) return;
+    if (!reopen) topup_cycles = 0;
+    t_last_target_started = t - t_resume_elapsed;
+    fill_learnable = t_resume_elapsed == 0;
+    fill_start_net_g = net_g;
+    t_resume_elapsed = 0;
+    last_target_g = target_g;
+    if (!reopen) captureArm();
+    enableOutput();
+    if (!reopen && !journal_active) journalStart(preset, target_g, offset_g, t - t_last_target_started);
+    if (!reopen) {
+      curveStart(t, preset, target_g);
+      curveSample(t, net_g);
+    }
+  }
+  else if (journal_active && net_g >= journal_next_g && net_g < target_g - target_g / JOURNAL_STEPS
+        && t - t_journal_written >= JOURNAL_INTERVAL_MS) {
+    journalProgress(net_g, t_last_target_duration);
+    journal_next_g = net_g + target_g / JOURNAL_STEPS;
   }
-  while (!loadcell.update());
-
-  // Übergang zur loop, mit Zustand, der den Schalter ausliest
-  stateTransition(11);
 }
 
-bool break_loop = false;
-void loop() {
-  static uint32_t t;
-  t = millis();
-
-  static uint32_t t_switch = 0;
-  static uint32_t t_last_weight_reading = t;
-  static uint32_t t_screen = 0;
-  static uint32_t t_tone_started = 0;
-
-  static float loadcell_reading = 0.0f;
-  
-  break_loop = false;
-
-  // Messwert aus Wiegezelle auslesen
-  if (loadcell.update()) {
-    t_last_weight_reading = t;
-    loadcell_reading = loadcell.getData();
-    if (loadcell_reading < -65536) current_weight_g = -65536;
-    else if (loadcell_reading > 65536) current_weight_g = 65536;
-    else if (current_weight_g != (long)loadcell_reading) {
-      current_weight_g = (long)loadcell_reading;
+// Rezept in Zustand 40, bei jedem Messwert
+void recipeControl(uint32_t t) {
+  const RecipeStep& step = recipe.steps[recipe_step];
+  long net_g = current_weight_g - recipe_tare_g;
+  switch (recipe_phase) {
+    case RECIPE_TARE: {
+      if (!weight_stable) break;
+      recipe_tare_g = current_weight_g;
+      recipe_phase = RECIPE_FILL;
+      t_last_target_started = t;
+      enableOutput(step.output);
       redraw_screen = true;
+      break;
+    }
+    case RECIPE_FILL: {
+      if (net_g < (long)step.target_g) break;
+      disableOutput();
+      t_last_target_duration = t - t_last_target_started;
+      recipe_phase = RECIPE_SETTLE;
+      t_recipe_phase = t;
+      redraw_screen = true;
+      break;
+    }
+    case RECIPE_SETTLE: {
+      // Nachlauf: erst nach der Pause und bei Stillstand zählt das Gewicht
+      if (t - t_recipe_phase < step.pause_s * 1000UL || !weight_stable) break;
+      recipe_actual_g[recipe_step] = net_g;
+      #ifdef SERIAL_ENABLED
+      Serial.print(txt(TXT_RECIPE_STEP_DONE));
+      Serial.print(recipe_step + 1);
+      Serial.print(txt(TXT_SEPARATOR));
+      Serial.print((long)step.target_g);
+      Serial.print(txt(TXT_SEPARATOR));
+      Serial.print(net_g);
+      Serial.print(txt(TXT_SEPARATOR));
+      Serial.println(t_last_target_duration);
+      #endif
+      recipe_phase = RECIPE_TARE;
+      redraw_screen = true;
+      if (++recipe_step >= recipe.count) {
+        fill_count++;
+        stateTransition(42);
+      }
+      break;
     }
   }
+}
 
-  // wenn zu lange kein Messwert mehr gelesen wurde --> Fehlerzustand
-  if (t - t_last_weight_reading > t_timeout_weight_reading && state != 2) stateTransition(2);
+void taskControl(uint32_t t) {
+  if (!weight_stable) container_evaluated = false;
+  switch (state) {
+    case 13: { controlFill(t, current_weight_g - p1_tara_offset_g, p1_target_g, 1, p1_tara_offset_g); break; }
+    case 18: { controlFill(t, current_weight_g - p2_tara_offset_g, p2_target_g, 2, p2_tara_offset_g); break; }
+    case 23: { controlFill(t, current_weight_g - p0_tara_offset_g, p0_target_g, 0, p0_tara_offset_g); break; }
+    case 14: {
+      settleCapture(t, current_weight_g - p1_tara_offset_g, p1_target_g);
+      autoCycle(t, p1_tara_offset_g, p1_target_g);
+      break;
+    }
+    case 19: {
+      settleCapture(t, current_weight_g - p2_tara_offset_g, p2_target_g);
+      autoCycle(t, p2_tara_offset_g, p2_target_g);
+      break;
+    }
+    case 24: {
+      settleCapture(t, current_weight_g - p0_tara_offset_g, p0_target_g);
+      autoCycle(t, p0_tara_offset_g, p0_target_g);
+      break;
+    }
+    case 22: { containerRecognize(); break; }
+    case 40: { recipeControl(t); break; }
+    case 32: { noiseTestSample(loadcell.getRawData()); redraw_screen = true; break; }
+  }
+}
 
-  // process current state
+// Darf der Ausgang im aktuellen Zustand an sein? Im Rezept nur der Ausgang des laufenden Schritts.
+bool outputAllowed() {
+  switch (state) {
+    case 13:
+    case 18:
+    case 23:
+    case 38: return output_channel == 0;
+    case 40: return recipe_phase == RECIPE_FILL && output_channel == recipe.steps[recipe_step].output;
+    default: return false;
+  }
+}
+
+void taskState(uint32_t t) {
   switch (state) {
     case 11: { // check switch state, then move to resp. next state
       disableOutput();
 
-      static uint8_t sw_pos = 0;
-      if (digitalRead(PIN_SW_1) == LOW) sw_pos = 1;
-      else if (digitalRead(PIN_SW_2) == LOW) sw_pos = 2;
-      else sw_pos = 0;
-
-      switch (sw_pos) {
+      switch (readSwitchPosition()) {
         case 0: { stateTransition(22); break; }
         case 1: { stateTransition(12); break; }
         case 2: { stateTransition(17); break; }
       }
-      break_loop = true;
       break;
     }
-    case 13: {
-      last_target_done_g = current_weight_g - p1_tara_offset_g;
-      t_last_target_duration = t - t_last_target_started;
-      if (current_weight_g - p1_tara_offset_g >= p1_target_g) stateTransition(14, 1);
-      else if (!output_enabled && current_weight_g - p1_tara_offset_g < p1_target_g) {
-        t_last_target_started = t;
-        last_target_g = p1_target_g;
-        enableOutput();
+    case 31: { // unterbrochene Befüllung fortsetzen, sobald die Wiegezelle eingeschwungen ist
+      if (!loadcell_warm) break;
+      t_resume_elapsed = journal.elapsed_s * 1000UL;
+      #ifdef SERIAL_ENABLED
+      Serial.print(txt(TXT_JOURNAL_RESUME));
+      Serial.println(t_resume_elapsed);
+      #endif
+      switch (journal.preset) {
+        case 1: { p1_target_g = journal.target_g; p1_tara_offset_g = journal.offset_g; stateTransition(13); break; }
+        case 2: { p2_target_g = journal.target_g; p2_tara_offset_g = journal.offset_g; stateTransition(18); break; }
+        default: { p0_target_g = journal.target_g; p0_tara_offset_g = journal.offset_g; stateTransition(23); break; }
       }
       break;
     }
-    case 18: {
-      last_target_done_g = current_weight_g - p2_tara_offset_g;
-      t_last_target_duration = t - t_last_target_started;
-      if (current_weight_g - p2_tara_offset_g >= p2_target_g) stateTransition(19, 1); 
-      else if (!output_enabled && current_weight_g - p2_tara_offset_g < p2_target_g) {
-        t_last_target_started = t;
-        last_target_g = p2_target_g;
-        enableOutput();
+    case 38: { // zeitgesteuerte Befüllung im Notbetrieb, Startzeit setzt der lange Klick in 37
+      uint32_t t_elapsed = millis() - t_degraded_started;
+      if (!input_stop_latched && t_elapsed < t_degraded_fill) {
+        if (!output_enabled) enableOutput();
+        redraw_screen = true;
+        break;
       }
+      disableOutput();
+      bool stopped = t_elapsed < t_degraded_fill;
+      #ifdef SERIAL_ENABLED
+      Serial.print(txt(TXT_DEGRADED_DONE));
+      Serial.print(stopped);
+      Serial.print(txt(TXT_SEPARATOR));
+      Serial.println(t_elapsed);
+      #endif
+      // nach STOPP bleibt der Rest für den nächsten Start stehen, sonst neuer Behälter
+      degradedPrepare(degraded_preset, stopped ? degradedDelivered(t_elapsed) : 0);
+      stateTransition(37);
       break;
     }
-    case 23: {
-      last_target_done_g = current_weight_g;
-      t_last_target_duration = t - t_last_target_started;
-      if (current_weight_g >= p0_target_g) stateTransition(24, 1);
-      else if (!output_enabled && current_weight_g < p0_target_g) {
-        t_last_target_started = t;
-        last_target_g = p0_target_g;
-        enableOutput();
-      }
+    case 32: {
+      if (t - t_noisetest_started < NOISETEST_DURATION_MS) break;
+      noiseTestFinish(t);
+      stateTransition(33);
       break;
     }
-    case 14:
-    case 19:
-    case 24: { // in diesen Zuständen ist die Dosierung regulär beendet und es wird die "Ende-Musik" gespielt. Könnte man sicherlich schöner programmieren! ;)
-      if (sub_state > 0 && use_endtone) {
-        switch (sub_state) {
-          case 1: { t_tone_started = t; tone(PIN_BEEP, BEEP_FREQ_A5, BEEP_UNIT_LENGTH); sub_state++; break; }
-          case 2: { if (t-t_tone_started>=BEEP_UNIT_LENGTH*4) {t_tone_started = t; tone(PIN_BEEP, BEEP_FREQ_F5, BEEP_UNIT_LENGTH); sub_state++;} break; }
-          case 3: { if (t-t_tone_started>=BEEP_UNIT_LENGTH*2) {t_tone_started = t; tone(PIN_BEEP, BEEP_FREQ_F5, BEEP_UNIT_LENGTH); sub_state++;} break; }
-          case 4: { if (t-t_tone_started>=BEEP_UNIT_LENGTH*2) {t_tone_started = t; tone(PIN_BEEP, BEEP_FREQ_G5, BEEP_UNIT_LENGTH); sub_state++;} break; }
-          case 5: { if (t-t_tone_started>=BEEP_UNIT_LENGTH*4) {t_tone_started = t; tone(PIN_BEEP, BEEP_FREQ_F5, BEEP_UNIT_LENGTH); sub_state++;} break; }
-          case 6: { if (t-t_tone_started>=BEEP_UNIT_LENGTH*8) {t_tone_started = t; tone(PIN_BEEP, BEEP_FREQ_A5, BEEP_UNIT_LENGTH); sub_state++;} break; }
-          case 7: { if (t-t_tone_started>=BEEP_UNIT_LENGTH*4) {t_tone_started = t; tone(PIN_BEEP, BEEP_FREQ_B5, BEEP_UNIT_LENGTH*4); sub_state++;} break; }          
-          case 8: { if (t-t_tone_started>=BEEP_UNIT_LENGTH*16) {t_tone_started = t; tone(PIN_BEEP, BEEP_FREQ_A5*2, BEEP_UNIT_LENGTH); sub_state++;} break; }
-          case 9: { if (t-t_tone_started>=BEEP_UNIT_LENGTH*4) {t_tone_started = t; tone(PIN_BEEP, BEEP_FREQ_F5*2, BEEP_UNIT_LENGTH); sub_state++;} break; }
-          case 10: { if (t-t_tone_started>=BEEP_UNIT_LENGTH*2) {t_tone_started = t; tone(PIN_BEEP, BEEP_FREQ_F5*2, BEEP_UNIT_LENGTH); sub_state++;} break; }
-          case 11: { if (t-t_tone_started>=BEEP_UNIT_LENGTH*2) {t_tone_started = t; tone(PIN_BEEP, BEEP_FREQ_G5*2, BEEP_UNIT_LENGTH); sub_state++;} break; }
-          case 12: { if (t-t_tone_started>=BEEP_UNIT_LENGTH*4) {t_tone_started = t; tone(PIN_BEEP, BEEP_FREQ_F5*2, BEEP_UNIT_LENGTH); sub_state++;} break; }
-          case 13: { if (t-t_tone_started>=BEEP_UNIT_LENGTH*8) {t_tone_started = t; tone(PIN_BEEP, BEEP_FREQ_A5*2, BEEP_UNIT_LENGTH); sub_state++;} break; }
-          case 14: { if (t-t_tone_started>=BEEP_UNIT_LENGTH*4) {t_tone_started = t; tone(PIN_BEEP, BEEP_FREQ_B5*2, BEEP_UNIT_LENGTH*4); sub_state++;} break; }
-          case 15: {
-            if (t-t_tone_started>=BEEP_UNIT_LENGTH*32 && endtone_repetitions_done < BEEP_END_REPETITIONS) {
-              sub_state = 1;
-              endtone_repetitions_done++;
-            } else if (endtone_repetitions_done >= BEEP_END_REPETITIONS) {
-              sub_state = 0;
-              endtone_repetitions_done = 0;
-            }
-            break;
-          }
-        }
-      }
+    case 34: {
+      eepromQueuePut(addr_filter_window, noisetest_window);
+      eepromQueuePut(addr_filter_window_saved_flag, (uint8_t)169);
+      loadcell.setSamples(noisetest_window);
+      #ifdef SERIAL_ENABLED
+      Serial.print(txt(TXT_FILTER_SAVED));
+      Serial.println(noisetest_window);
+      #endif
+      stateTransition(26);
       break;
     }
     case 28: {
       uint8_t settings_new = getToggleSettingsFromState();
-      EEPROM.put(addr_toggle_settings, settings_new);
+      eepromQueuePut(addr_toggle_settings, settings_new);
       #ifdef SERIAL_ENABLED
-      Serial.print(F("(28) Einstellungen im EEPROM gespeichert: "));
+      Serial.print(txt(TXT_SETTINGS_SAVED));
       Serial.println(settings_new, BIN);
       #endif
       stateTransition(22);
       break;
     }
     case 29: {
-      for (uint16_t i = 0 ; i < EEPROM.length() ; i++) EEPROM.write(i, 0);
+      // EEPROM über die Warteschlange löschen, neu starten, sobald alles geschrieben ist
+      if (sub_state == 0) {
+        eepromQueueFill(0, EEPROM.length(), 0);
+        sub_state = 1;
+        break;
+      }
+      if (eepromQueueBusy()) break;
       #ifdef SERIAL_ENABLED
-      Serial.println(F("(29) Es wurde alles zurückgesetzt. Starte neu..."));
+      Serial.println(txt(TXT_RESET_DONE));
       #endif
       reset_function();
     }
@@ -1108,8 +3990,11 @@ void loop() {
       loadcell.tare();
       long tar_value = loadcell.getTareOffset();
       loadcell.setTareOffset(tar_value);
+      // neue Kalibrierung beginnt ohne Kalibrierpunkte
+      cal_points_count = 0;
+      calibrationRebuild();
       #ifdef SERIAL_ENABLED
-      Serial.print(F("(41) Tara abgeschlossen. Neuer Wert für tara_offset: "));
+      Serial.print(txt(TXT_TARE_41));
       Serial.println(tar_value);
       #endif
       stateTransition(5);
@@ -1118,24 +4003,40 @@ void loop() {
     case 61: {
       loadcell.update();
       loadcell.refreshDataSet();
-      float cal_value = loadcell.getNewCalibration(cal_known_mass_g);
+      long raw = loadcell.getSmoothedData() - loadcell.getTareOffset();
+      // der erste Punkt liefert wie bisher auch den (linearen) Kalibrierungsfaktor, sein Vorzeichen
+      // legt die Polarität der Wiegezelle fest
+      if (cal_points_count == 0 && raw != 0) loadcell.getNewCalibration(cal_known_mass_g);
+      cal_point_rejected = !calibrationAddPoint(raw, cal_known_mass_g);
+      if (cal_point_rejected && use_keytones) tone(PIN_BEEP, BEEP_FREQ_ERR, beep_length_err);
       #ifdef SERIAL_ENABLED
-      Serial.print(F("(61) Kalibrierung abgeschlossen. Neuer Wert für cal_value: "));
-      Serial.println(cal_value);
+      Serial.print(txt(cal_point_rejected ? TXT_CAL_REJECTED : TXT_CAL_DONE));
+      Serial.print(loadcell.getCalFactor());
+      Serial.print(txt(TXT_SEPARATOR));
+      Serial.print(raw);
+      Serial.print(txt(TXT_SEPARATOR));
+      Serial.println(cal_known_mass_g);
       #endif
-      stateTransition(7);
+      if (cal_points_count < CAL_POINTS_MAX) stateTransition(62);
+      else stateTransition(7);
       break;
     }
     case 71: {
       float cal_value = loadcell.getCalFactor();
       long tar_value = loadcell.getTareOffset();
-      EEPROM.put(addr_cal_value, cal_value);
-      EEPROM.put(addr_tar_value, tar_value);
-      EEPROM.put(addr_saved_flag, (uint8_t)169);
+      eepromQueuePut(addr_cal_value, cal_value);
+      eepromQueuePut(addr_tar_value, tar_value);
+      eepromQueuePut(addr_saved_flag, (uint8_t)169);
+      for (uint8_t i = 0; i < cal_points_count; i++) {
+        eepromQueuePut(addr_cal_points + i*8, cal_knot_raw[i+1]);
+        eepromQueuePut(addr_cal_points + i*8 + 4, cal_knot_mass_g[i+1]);
+      }
+      eepromQueuePut(addr_cal_points_count, cal_points_count);
+      eepromQueuePut(addr_cal_points_saved_flag, (uint8_t)169);
       #ifdef SERIAL_ENABLED
-      Serial.print(F("(71) Kalibrierungswerte im EEPROM gespeichert: "));
+      Serial.print(txt(TXT_CAL_SAVED));
       Serial.print(cal_value);
-      Serial.print(F(" / "));
+      Serial.print(txt(TXT_SEPARATOR));
       Serial.println(tar_value);
       #endif
       stateTransition(11);
@@ -1147,7 +4048,7 @@ void loop() {
       tar_value = loadcell.getTareOffset();
       loadcell.setTareOffset(tar_value);
       #ifdef SERIAL_ENABLED
-      Serial.print(F("(91) Tara abgeschlossen. Neuer Wert für tara_offset: "));
+      Serial.print(txt(TXT_TARE_91));
       Serial.println(tar_value);
       #endif
       stateTransition(10);
@@ -1155,34 +4056,34 @@ void loop() {
     }
     case 101: {
       long tar_value = loadcell.getTareOffset();
-      EEPROM.put(addr_tar_value, tar_value);
-      EEPROM.put(addr_saved_flag, (uint8_t)169);
+      eepromQueuePut(addr_tar_value, tar_value);
+      eepromQueuePut(addr_saved_flag, (uint8_t)169);
       #ifdef SERIAL_ENABLED
-      Serial.print(F("(101) Tara-Offset im EEPROM gespeichert: "));
+      Serial.print(txt(TXT_TARE_SAVED));
       Serial.println(tar_value);
       #endif
       stateTransition(11);
       break;
     }
     case 151: {
-      EEPROM.put(addr_p1_target, p1_target_g);
-      EEPROM.put(addr_p1_offset, p1_tara_offset_g);
+      eepromQueuePut(addr_p1_target, p1_target_g);
+      eepromQueuePut(addr_p1_offset, p1_tara_offset_g);
       #ifdef SERIAL_ENABLED
-      Serial.print(F("(151) Sollwert / Tara-Versatz für VE 1 im EEPROM gespeichert: "));
+      Serial.print(txt(TXT_P1_SAVED));
       Serial.print(p1_target_g);
-      Serial.print(F(" / "));
+      Serial.print(txt(TXT_SEPARATOR));
       Serial.println(p1_tara_offset_g);
       #endif
       stateTransition(12);
       break;
     }
     case 201: {
-      EEPROM.put(addr_p2_target, p2_target_g);
-      EEPROM.put(addr_p2_offset, p2_tara_offset_g);
+      eepromQueuePut(addr_p2_target, p2_target_g);
+      eepromQueuePut(addr_p2_offset, p2_tara_offset_g);
       #ifdef SERIAL_ENABLED
-      Serial.print(F("(201) Sollwert / Tara-Versatz für VE 2 im EEPROM gespeichert: "));
+      Serial.print(txt(TXT_P2_SAVED));
       Serial.print(p2_target_g);
-      Serial.print(F(" / "));
+      Serial.print(txt(TXT_SEPARATOR));
       Serial.println(p2_tara_offset_g);
       #endif
       stateTransition(17);
@@ -1191,202 +4092,50 @@ void loop() {
   }
 
   // Ausgang ausschalten, wenn nicht in einem entsprechenden State
-  if (output_enabled && state != 13 && state != 18 && state != 23) {
-    disableOutput();
-  }
+  if (output_enabled && !outputAllowed()) disableOutput();
+}
 
-  // Für manche Zustaände wird der Rest des loop übersprungen, weil unnötig
-  if (break_loop) {
-    #ifdef SERIAL_ENABLED
-    Serial.println(F("The loop has been broken. Just like my heart <|3"));
-    #endif
-    return;
+void taskInput(uint32_t t) {
+  // Ereignisse des Dreh-Drück-Knopfs verarbeiten, pro Durchlauf eines
+  inputService(t);
+  uint8_t event, interval;
+  if (!inputPop(event, interval)) return;
+  switch (event) {
+    case EVENT_TURN_RIGHT: { onTurn(false, interval); break; }
+    case EVENT_TURN_LEFT: { onTurn(true, interval); break; }
+    case EVENT_CLICK_SHORT: { shortClick_enc(); break; }
+    case EVENT_CLICK_LONG: { longClick_enc(); break; }
   }
+}
 
-  // Dreh-Drück-Knopf Änderungen verarbeiten (Library)
-  encoder.process();
-  btn_enc.process();
-
-  // VE-Wahl-Schalter prüfen
-  if (t - t_switch > t_intv_switch) {
-    t_switch = t;
+void taskSwitch(uint32_t t) {
+  // VE-Wahl-Schalter erst auslesen, wenn laut Interrupt eine Änderung vorliegt und die Kontakte ausgeprellt sind
+  bool settled = false;
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    if (sw_changed && t - t_sw_changed >= t_debounce_switch) {
+      sw_changed = false;
+      settled = true;
+    }
+  }
+  if (settled) {
     sw_pos_pre = sw_pos;
-    if (digitalRead(PIN_SW_1) == LOW) sw_pos = 1;
-    else if (digitalRead(PIN_SW_2) == LOW) sw_pos = 2;
-    else sw_pos = 0;
-
+    sw_pos = readSwitchPosition();
     if (sw_pos != sw_pos_pre) sw_event = true;
   }
 
-  // Bildschrim aktualisieren, wenn erforderlich
-  if (t - t_screen > t_intv_screen && redraw_screen) {
-    t_screen = t;
-    redraw_screen = false;
-
-    switch(state) {
-      case 6: {
-        lcd.setCursor(3,1);
-        lcd.print(cal_known_mass_g/10000);
-        lcd.print(cal_known_mass_g % 10000 / 1000);
-        lcd.write('.');
-        lcd.print(cal_known_mass_g % 1000 / 100);
-        lcd.print(cal_known_mass_g % 100 / 10);
-        lcd.print(F(" kg "));
-        if (cal_known_mass_ok) lcd.write(1); else lcd.write(4);
-        switch (sub_state) {
-          case 0: { lcd.setCursor(3,1); break; }
-          case 1: { lcd.setCursor(4,1); break; }
-          case 2: { lcd.setCursor(6,1); break; }
-          case 3: { lcd.setCursor(7,1); break; }
-          case 4: { lcd.setCursor(12,1); break; }
-        }
-        lcd.blink();
-        break;
-      }
-      case 7: 
-      case 10: {
-        lcd.setCursor(2,1);
-        if (sub_state == 0) lcd.write(' '); else lcd.write(0);
-        lcd.setCursor(9,1);
-        if (sub_state == 0) lcd.write(0); else lcd.write(' ');
-        break;
-      }
-      case 12: 
-      case 17: {
-        lcd.setCursor(0,0);
-        if (sub_state == 2) lcd.write(0); else lcd.write(' ');
-        if (state == 12) {
-          drawCurrentWeight(&current_weight_g, &p1_tara_offset_g);
-          drawTragetWeight(&p1_target_g);
-          drawTaraOffsetValue(&p1_tara_offset_g);
-        } else {
-          drawCurrentWeight(&current_weight_g, &p2_tara_offset_g);
-          drawTragetWeight(&p2_target_g);
-          drawTaraOffsetValue(&p2_tara_offset_g);
-        }
-        lcd.setCursor(1,1);
-        if (sub_state == 0) lcd.write(0); else lcd.write(' ');
-        lcd.setCursor(8,1);
-        if (sub_state == 1) lcd.write(0); else lcd.write(' ');
-        break;
-      }
-      case 13: {
-        drawCurrentWeight(&current_weight_g, &p1_tara_offset_g);
-        drawTragetWeight(&p1_target_g);
-        break;
-      }
-      case 15:
-      case 20: {
-        lcd.setCursor(0,0);
-        lcd.write(0);
-        if (state == 15) {
-          drawCurrentWeight(&current_weight_g, &p1_tara_offset_g);
-          drawTragetWeight(&p1_target_g);
-          if (p1_target_ok) lcd.write(1); else lcd.write(4);
-        } else {
-          drawCurrentWeight(&current_weight_g, &p2_tara_offset_g);
-          drawTragetWeight(&p2_target_g);
-          if (p2_target_ok) lcd.write(1); else lcd.write(4);
-        }
-        
-        switch (sub_state) {
-          case 0: { lcd.setCursor(7,0); break; }
-          case 1: { lcd.setCursor(8,0); break; }
-          case 2: { lcd.setCursor(10,0); break; }
-          case 3: { lcd.setCursor(11,0); break; }
-        }
-        lcd.blink();
-        break;
-      }
-      case 16: 
-      case 21: {
-        lcd.setCursor(8,1);
-        lcd.write(0);
-        
-        if (state == 16) {
-          drawCurrentWeight(&current_weight_g, &p1_tara_offset_g);
-          drawTaraOffsetValue(&p1_tara_offset_g);
-          if (p1_tara_offset_ok) lcd.write(1); else lcd.write(4);
-        } else {
-          drawCurrentWeight(&current_weight_g, &p2_tara_offset_g);
-          drawTaraOffsetValue(&p2_tara_offset_g);
-          if (p2_tara_offset_ok) lcd.write(1); else lcd.write(4);
-        }
-
-        switch(sub_state) {
-          case 0: { lcd.setCursor(11,1); break; }
-          case 1: { lcd.setCursor(13,1); break; }
-          case 2: { lcd.setCursor(14,1); break; }
-          case 3: { lcd.setCursor(15,1); break; }
-        }
-        lcd.blink();
-        break;
-      }
-      case 18: {
-        drawCurrentWeight(&current_weight_g, &p2_tara_offset_g);
-        drawTragetWeight(&p2_target_g);
-        break;
-      }
-      case 22: {
-        lcd.setCursor(0,0);
-        if (sub_state == 2) lcd.write(0); else lcd.write(' ');
-        drawCurrentWeight(&current_weight_g);
-        drawTragetWeight(&p0_target_g);
-        lcd.setCursor(1,1);
-        if (sub_state == 0) lcd.write(0); else lcd.write(' ');
-        lcd.setCursor(9,1);
-        if (sub_state == 1) lcd.write(0); else lcd.write(' ');
-        break;
-      }
-      case 23: {
-        drawCurrentWeight(&current_weight_g);
-        drawTragetWeight(&p0_target_g);
-        break;
-      }
-      case 25: {
-        lcd.setCursor(0,0);
-        lcd.write(0);
-        drawCurrentWeight(&current_weight_g);
-        drawTragetWeight(&p0_target_g);
-        if (p0_target_ok) lcd.write(1); else lcd.write(4);
-        switch (sub_state) {
-          case 0: { lcd.setCursor(7,0); break; }
-          case 1: { lcd.setCursor(8,0); break; }
-          case 2: { lcd.setCursor(10,0); break; }
-          case 3: { lcd.setCursor(11,0); break; }
-        }
-        lcd.blink();
-        break;
-      }
-      case 26: {
-        for (uint8_t row = 0; row < 2; row++) {
-          for (uint8_t col = 0; col < 3; col++) {
-            lcd.setCursor(col*6,row); if (sub_state == row*3+col) lcd.write(0); else lcd.write(' ');
-          }
-        }
-        lcd.setCursor(9,0); if (use_keytones) lcd.write(1); else lcd.write(2);
-        lcd.setCursor(15,0); if (use_endtone) lcd.write(1); else lcd.write(2);
-        break;
-      }
-      case 27: {
-        lcd.setCursor(8,1);
-        if (sub_state == 0) lcd.write(0); else lcd.write(' ');
-        lcd.setCursor(13,1);
-        if (sub_state == 0) lcd.write(' '); else lcd.write(0);
-        break;
-      }
-    }
-  }
-
   // VE-Wahl-Schalter Änderung verarbeiten
   if (sw_event) {
     // Änderung bewirkt immer einen Übergang in Zustand 11, außer bei einigen Zustaänden
     if ( state == 9 || state == 91 || state == 10  || state ==  101 // Tara-Prozess
-      || state == 4 || state == 41 || state == 5 || state == 6 || state == 61 || state == 7 || state == 71 // Kalibrierungs-Prozess
+      || state == 4 || state == 41 || state == 5 || state == 6 || state == 61 || state == 62 || state == 7 || state == 71 // Kalibrierungs-Prozess
+      || state == 30 || state == 31 // Fortsetzen nach Spannungsausfall
+      || state == 29 // EEPROM wird gelöscht
+      || state == 38 // zeitgesteuerte Befüllung im Notbetrieb
+      || state == 40 // Rezept läuft
     ) return;
     else {
       #ifdef SERIAL_ENABLED
-      Serial.print("Switch changed to position ");
+      Serial.print(txt(TXT_SWITCH_CHANGED));
       Serial.println(sw_pos);
       #endif
 
@@ -1396,4 +4145,198 @@ void loop() {
       sw_event = false;
     }    
   }
-}
\ No newline at end of file
+}
+
+void taskDisplay(uint32_t t) {
+  // Bildschrim aktualisieren, wenn erforderlich
+  if (!redraw_screen) return;
+  redraw_screen = false;
+  if (screen_layout != nullptr) screenUpdate(screen_layout, sub_state);
+}
+
+void taskAudio(uint32_t t) {
+  static uint32_t t_tone_started = 0;
+
+  // in diesen Zuständen ist die Dosierung regulär beendet und es wird die "Ende-Musik" gespielt. Könnte man sicherlich schöner programmieren! ;)
+  if (state != 14 && state != 19 && state != 24) return;
+  if (sub_state > 0 && use_endtone) {
+    switch (sub_state) {
+      case 1: { t_tone_started = t; tone(PIN_BEEP, BEEP_FREQ_A5, BEEP_UNIT_LENGTH); sub_state++; break; }
+      case 2: { if (t-t_tone_started>=BEEP_UNIT_LENGTH*4) {t_tone_started = t; tone(PIN_BEEP, BEEP_FREQ_F5, BEEP_UNIT_LENGTH); sub_state++;} break; }
+      case 3: { if (t-t_tone_started>=BEEP_UNIT_LENGTH*2) {t_tone_started = t; tone(PIN_BEEP, BEEP_FREQ_F5, BEEP_UNIT_LENGTH); sub_state++;} break; }
+      case 4: { if (t-t_tone_started>=BEEP_UNIT_LENGTH*2) {t_tone_started = t; tone(PIN_BEEP, BEEP_FREQ_G5, BEEP_UNIT_LENGTH); sub_state++;} break; }
+      case 5: { if (t-t_tone_started>=BEEP_UNIT_LENGTH*4) {t_tone_started = t; tone(PIN_BEEP, BEEP_FREQ_F5, BEEP_UNIT_LENGTH); sub_state++;} break; }
+      case 6: { if (t-t_tone_started>=BEEP_UNIT_LENGTH*8) {t_tone_started = t; tone(PIN_BEEP, BEEP_FREQ_A5, BEEP_UNIT_LENGTH); sub_state++;} break; }
+      case 7: { if (t-t_tone_started>=BEEP_UNIT_LENGTH*4) {t_tone_started = t; tone(PIN_BEEP, BEEP_FREQ_B5, BEEP_UNIT_LENGTH*4); sub_state++;} break; }          
+      case 8: { if (t-t_tone_started>=BEEP_UNIT_LENGTH*16) {t_tone_started = t; tone(PIN_BEEP, BEEP_FREQ_A5*2, BEEP_UNIT_LENGTH); sub_state++;} break; }
+      case 9: { if (t-t_tone_started>=BEEP_UNIT_LENGTH*4) {t_tone_started = t; tone(PIN_BEEP, BEEP_FREQ_F5*2, BEEP_UNIT_LENGTH); sub_state++;} break; }
+      case 10: { if (t-t_tone_started>=BEEP_UNIT_LENGTH*2) {t_tone_started = t; tone(PIN_BEEP, BEEP_FREQ_F5*2, BEEP_UNIT_LENGTH); sub_state++;} break; }
+      case 11: { if (t-t_tone_started>=BEEP_UNIT_LENGTH*2) {t_tone_started = t; tone(PIN_BEEP, BEEP_FREQ_G5*2, BEEP_UNIT_LENGTH); sub_state++;} break; }
+      case 12: { if (t-t_tone_started>=BEEP_UNIT_LENGTH*4) {t_tone_started = t; tone(PIN_BEEP, BEEP_FREQ_F5*2, BEEP_UNIT_LENGTH); sub_state++;} break; }
+      case 13: { if (t-t_tone_started>=BEEP_UNIT_LENGTH*8) {t_tone_started = t; tone(PIN_BEEP, BEEP_FREQ_A5*2, BEEP_UNIT_LENGTH); sub_state++;} break; }
+      case 14: { if (t-t_tone_started>=BEEP_UNIT_LENGTH*4) {t_tone_started = t; tone(PIN_BEEP, BEEP_FREQ_B5*2, BEEP_UNIT_LENGTH*4); sub_state++;} break; }
+      case 15: {
+        if (t-t_tone_started>=BEEP_UNIT_LENGTH*32 && endtone_repetitions_done < BEEP_END_REPETITIONS) {
+          sub_state = 1;
+          endtone_repetitions_done++;
+        } else if (endtone_repetitions_done >= BEEP_END_REPETITIONS) {
+          sub_state = 0;
+          endtone_repetitions_done = 0;
+        }
+        break;
+      }
+    }
+  }
+}
+
+// Laufzeit-Statistik aller Tasks ausgeben, bei only_changed nur die mit neuen Fristüberschreitungen
+void printTaskStats(bool only_changed) {
+  #ifdef SERIAL_ENABLED
+  static uint16_t overruns_reported[TASK_COUNT];
+  for (uint8_t i = 0; i < TASK_COUNT; i++) {
+    if (only_changed && tasks[i].overruns == overruns_reported[i]) continue;
+    overruns_reported[i] = tasks[i].overruns;
+    Serial.print(txt(TXT_TASK));
+    Serial.print(i);
+    Serial.print(txt(TXT_COLON));
+    Serial.print(tasks[i].overruns);
+    Serial.print(txt(TXT_TASK_STATS));
+    Serial.print(tasks[i].max_runtime_us);
+    Serial.println(txt(TXT_US));
+  }
+  #endif
+}
+
+void taskLog(uint32_t t) {
+  printTaskStats(true);
+}
+
+// Befehle über die Serielle Konsole (Zeilenende \n):
+//   mem    - RAM-Belegung und maximale Stack-Tiefe seit dem Start
+//   tasks  - Laufzeit-Statistik aller Tasks
+void serialCommand(char* line) {
+  #ifdef SERIAL_ENABLED
+  if (strcmp_P(line, PSTR("mem")) == 0) printMemoryStats();
+  else if (strcmp_P(line, PSTR("tasks")) == 0) printTaskStats(false);
+  else if (strcmp_P(line, PSTR("curves")) == 0) curvesExport();
+  else if (strcmp_P(line, PSTR("capture")) == 0) captureExport();
+  else if (strcmp_P(line, PSTR("capture save")) == 0) {
+    if (!captureSave()) Serial.println(txt(TXT_CAPTURE_NOTHING_TO_SAVE));
+  }
+  else if (strcmp_P(line, PSTR("containers")) == 0) containersPrint();
+  else if (strcmp_P(line, PSTR("flow")) == 0) flowPrint();
+  else if (strcmp_P(line, PSTR("overshoot")) == 0) overshootPrint();
+  else if (strcmp_P(line, PSTR("overshoot clear")) == 0) {
+    for (uint8_t i = 0; i < FLOW_PRESETS; i++) overshootClear(i);
+    overshootPrint();
+  }
+  else if (strcmp_P(line, PSTR("recipes")) == 0) recipesPrint();
+  else if (strcmp_P(line, PSTR("params")) == 0) {
+    for (uint8_t id = 0; id < PARAM_COUNT; id++) paramPrint(id);
+  }
+  else if (strncmp_P(line, PSTR("get "), 4) == 0) {
+    uint8_t id = paramFind(line + 4);
+    if (id < PARAM_COUNT) paramPrint(id);
+    else {
+      Serial.print(txt(TXT_PARAM_UNKNOWN));
+      Serial.println(line + 4);
+    }
+  }
+  else if (strncmp_P(line, PSTR("set "), 4) == 0) paramCommand(line + 4);
+  else if (strncmp_P(line, PSTR("recipe "), 7) == 0) {
+    recipeCommand(line + 7);
+    recipesPrint();
+  }
+  else if (strncmp_P(line, PSTR("container "), 10) == 0) {
+    containerCommand(line + 10);
+    containersPrint();
+  }
+  else if (strncmp_P(line, PSTR("curveint "), 9) == 0) {
+    // Abtastintervall der Füllkurven (s), gilt ab der nächsten Befüllung
+    int interval = atoi(line + 9);
+    if (interval >= 1 && interval <= CURVE_INTERVAL_MAX_S) {
+      curve_interval_s = interval;
+      eepromQueuePut(addr_curve_interval, curve_interval_s);
+    }
+    Serial.print(txt(TXT_CURVE_INTERVAL));
+    Serial.println(curve_interval_s);
+  }
+  else {
+    Serial.print(txt(TXT_UNKNOWN_COMMAND));
+    Serial.println(line);
+  }
+  #endif
+}
+
+void taskSerial(uint32_t t) {
+  #ifdef SERIAL_ENABLED
+  static char line[32];
+  static uint8_t length = 0;
+  while (Serial.available()) {
+    char c = Serial.read();
+    if (c == '\r') continue;
+    if (c == '\n') {
+      line[length] = '\0';
+      if (length > 0) serialCommand(line);
+      length = 0;
+      return;   // höchstens ein Befehl pro Durchlauf
+    }
+    if (length < sizeof(line) - 1) line[length++] = c;
+  }
+  #endif
+}
+
+// höchstens ein Frame pro Durchlauf, Empfang und Senden laufen per Interrupt
+void taskModbus(uint32_t t) {
+  #ifdef MODBUS_ENABLED
+  modbusPoll();
+  #endif
+}
+
+Task tasks[TASK_COUNT] = {
+  // run,         period_ms,        deadline_ms
+  { taskControl,  0,                10 },
+  { taskState,    0,                50 },
+  { taskInput,    0,                20 },
+  { taskSwitch,   10,               50 },
+  { taskDisplay,  DEFAULT_T_INTV_SCREEN, 100 },
+  { taskAudio,    10,               20 },
+  { taskLog,      10000,            1000 },
+  { taskSerial,   50,               100 },
+  { taskModbus,   0,                20 },
+};
+
+void paramsApply() {
+  tasks[TASK_DISPLAY].period_ms = t_intv_screen;
+}
+
+// ohne das zählte die Laufzeit von setup() beim ersten Durchlauf als Verspätung jedes Tasks
+void tasksStart() {
+  uint32_t t = millis();
+  for (uint8_t id = 0; id < TASK_COUNT; id++) tasks[id].t_due = t;
+}
+
+void runTask(uint8_t id) {
+  Task& task = tasks[id];
+  uint32_t t = millis();
+  if ((int32_t)(t - task.t_due) > (int32_t)task.deadline_ms && task.overruns < UINT16_MAX) task.overruns++;
+
+  uint32_t t_start_us = micros();
+  task.run(t);
+  uint32_t runtime_us = micros() - t_start_us;
+  if (runtime_us > task.max_runtime_us) task.max_runtime_us = runtime_us > UINT16_MAX ? UINT16_MAX : runtime_us;
+
+  task.t_due = t + task.period_ms;
+}
+
+// noinline: loop() bleibt trotz LTO ein eigenes Symbol, damit tools/simavr die Zyklen pro Durchlauf messen kann
+__attribute__((noinline)) void loop() {
+  // Ein Durchlauf prüft alle Tasks in der Reihenfolge ihrer Priorität. Vor jedem Task wird
+  // die Wiegezelle abgefragt, damit die Regelung bei neuem Messwert immer zuerst dran ist.
+  // Die Latenz der Regelung ist damit durch die Laufzeit des längsten Tasks begrenzt.
+  for (uint8_t id = TASK_CONTROL + 1; id < TASK_COUNT; id++) {
+    uint32_t t = millis();
+    if (pollLoadcell(t)) runTask(TASK_CONTROL);
+    if ((int32_t)(t - tasks[id].t_due) >= 0) runTask(id);
+  }
+}
@@ -0,0 +1,266 @@
+/* MIT License
+
+Copyright (c) 2024 mva-one
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include <util/atomic.h>
+#include <util/crc16.h>
+#include "fastpin.h"
+
+/*
+    Modbus-RTU-Slave auf dem Hardware-UART (RS-485, halbduplex), ersetzt dann die Serielle Konsole.
+
+    Empfang und Senden laufen komplett in Interrupts:
+      - USART_RX:   Byte in den Puffer, Timer 1 neu starten. Liegt zwischen zwei Zeichen mehr als
+                    1,5 Zeichen Pause, ist der Frame ungültig.
+      - TIMER1_COMPA: 3,5 Zeichen Ruhe -> Frame vollständig. Ist er an diese Adresse oder
+                    Broadcast gerichtet, wird der Empfang bis zur Auswertung gesperrt, sonst
+                    verworfen.
+      - USART_UDRE: nächstes Byte der Antwort
+      - USART_TX:   letztes Bit draußen -> Treiber (DE) aus, Empfang wieder frei
+    Ausgewertet wird ein vollständiger Frame in modbusPoll() aus der loop heraus, Anfrage und
+    Antwort teilen sich einen Puffer. Die Anwendung stellt die Register über zwei Funktionen bereit:
+
+      uint8_t modbusReadRegister(bool input, uint16_t address, uint16_t* value);
+      uint8_t modbusWriteRegister(uint16_t address, uint16_t value);
+
+    Rückgabe 0 = OK, sonst Modbus-Exception-Code. Unterstützt: 03, 04, 06, 16. Adresse 0 ist
+    Broadcast (nur Schreiben, keine Antwort).
+
+    Enthält die ISRs, darf also nur einmal eingebunden werden. Timer 1 wird belegt.
+ */
+
+#define MODBUS_BAUD 19200
+
+// Puffer für Anfrage und Antwort -> max. 29 Register lesen bzw. 27 Register schreiben pro Frame
+#define MODBUS_BUFFER_SIZE 64
+#define MODBUS_MAX_READ ((MODBUS_BUFFER_SIZE - 5) / 2)
+#define MODBUS_MAX_WRITE ((MODBUS_BUFFER_SIZE - 9) / 2)
+
+// Zeitverhalten laut Spezifikation: 11 Bit pro Zeichen (8E1), oberhalb 19200 Baud feste Werte.
+// Timer 1 läuft mit Vorteiler 8 -> 0,5 us pro Takt.
+#define MODBUS_CHAR_US (11000000UL / MODBUS_BAUD)
+#define MODBUS_T15_US (MODBUS_BAUD > 19200 ? 750UL : 16500000UL / MODBUS_BAUD)
+#define MODBUS_T35_US (MODBUS_BAUD > 19200 ? 1750UL : 38500000UL / MODBUS_BAUD)
+#define MODBUS_T35_TICKS (MODBUS_T35_US * 2)
+#define MODBUS_GAP_TICKS ((MODBUS_T15_US + MODBUS_CHAR_US) * 2)   // Abstand zweier Empfangs-Interrupts
+
+#define MODBUS_EX_ILLEGAL_FUNCTION 0x01
+#define MODBUS_EX_ILLEGAL_ADDRESS 0x02
+#define MODBUS_EX_ILLEGAL_VALUE 0x03
+#define MODBUS_EX_DEVICE_FAILURE 0x04
+
+uint8_t modbusReadRegister(bool input, uint16_t address, uint16_t* value);
+uint8_t modbusWriteRegister(uint16_t address, uint16_t value);
+
+enum ModbusState : uint8_t {
+  MODBUS_RECEIVE,     // Empfang läuft bzw. Bus ist frei
+  MODBUS_FRAME,       // vollständiger Frame liegt im Puffer
+  MODBUS_TRANSMIT,    // Antwort wird gesendet
+};
+
+struct ModbusCounters {
+  uint16_t frames;        // gültige Frames an diese Adresse (inkl. Broadcast)
+  uint16_t crc_errors;    // Frames mit falscher Prüfsumme
+  uint16_t frame_errors;  // Zeichen-Pause > 1,5 Zeichen, Paritäts-/Rahmenfehler, Pufferüberlauf
+  uint16_t exceptions;    // gesendete Exception-Antworten
+};
+
+static uint8_t modbus_buffer[MODBUS_BUFFER_SIZE];
+static volatile uint8_t modbus_length = 0;
+static volatile uint8_t modbus_tx_index = 0;
+static volatile bool modbus_frame_invalid = false;
+static volatile ModbusState modbus_state = MODBUS_RECEIVE;
+static uint8_t modbus_address = 1;
+ModbusCounters modbus_counters;
+
+// Treiber-Freigabe (DE und /RE gebrückt) des RS-485-Transceivers
+#ifndef MODBUS_PIN_DE
+#define MODBUS_PIN_DE 12
+#endif
+typedef FastPin<MODBUS_PIN_DE> ModbusDePin;
+
+void modbusBegin(uint8_t address) {
+  modbus_address = address;
+  ModbusDePin::low();
+  ModbusDePin::output();
+
+  // UART: 8E1, U2X für geringen Baudraten-Fehler
+  UBRR0 = F_CPU / 8 / MODBUS_BAUD - 1;
+  UCSR0A = _BV(U2X0);
+  UCSR0C = _BV(UPM01) | _BV(UCSZ01) | _BV(UCSZ00);
+  UCSR0B = _BV(RXEN0) | _BV(TXEN0) | _BV(RXCIE0);
+
+  // Timer 1: CTC, Vorteiler 8, Vergleichswert = 3,5 Zeichen, Interrupt erst beim ersten Zeichen
+  TCCR1A = 0;
+  TCCR1B = _BV(WGM12) | _BV(CS11);
+  OCR1A = MODBUS_T35_TICKS;
+  TIMSK1 = 0;
+}
+
+ISR(USART_RX_vect) {
+  uint8_t status = UCSR0A;
+  uint8_t data = UDR0;
+  uint16_t gap = TCNT1;
+  TCNT1 = 0;
+  if (modbus_state != MODBUS_RECEIVE) return;
+
+  if (status & (_BV(FE0) | _BV(DOR0) | _BV(UPE0))) modbus_frame_invalid = true;
+  if (modbus_length > 0 && gap > MODBUS_GAP_TICKS) modbus_frame_invalid = true;
+  if (modbus_length < MODBUS_BUFFER_SIZE) modbus_buffer[modbus_length++] = data;
+  else modbus_frame_invalid = true;
+
+  TIFR1 = _BV(OCF1A);
+  TIMSK1 = _BV(OCIE1A);
+}
+
+ISR(TIMER1_COMPA_vect) {
+  TIMSK1 = 0;
+  if (modbus_state != MODBUS_RECEIVE || modbus_length == 0) return;
+  if (modbus_frame_invalid) {
+    modbus_counters.frame_errors++;
+    modbus_frame_invalid = false;
+    modbus_length = 0;
+  }
+  // Frames an andere Teilnehmer bzw. zu kurze Frames gar nicht erst an modbusPoll() geben,
+  // der Empfang bleibt frei und die nächste Anfrage auf dem Bus geht nicht verloren
+  else if (modbus_length < 4 || (modbus_buffer[0] != 0 && modbus_buffer[0] != modbus_address)) modbus_length = 0;
+  else modbus_state = MODBUS_FRAME;
+}
+
+ISR(USART_UDRE_vect) {
+  UCSR0A = (UCSR0A & _BV(U2X0)) | _BV(TXC0);   // TXC löschen, U2X beibehalten
+  UDR0 = modbus_buffer[modbus_tx_index++];
+  if (modbus_tx_index >= modbus_length) UCSR0B = (UCSR0B & ~_BV(UDRIE0)) | _BV(TXCIE0);
+}
+
+ISR(USART_TX_vect) {
+  ModbusDePin::low();
+  modbus_length = 0;
+  modbus_state = MODBUS_RECEIVE;
+  UCSR0B = (UCSR0B & ~_BV(TXCIE0)) | _BV(RXEN0);
+}
+
+uint16_t modbusCrc(const uint8_t* data, uint8_t length) {
+  uint16_t crc = 0xFFFF;
+  while (length--) crc = _crc16_update(crc, *data++);
+  return crc;
+}
+
+static inline uint16_t modbusWord(uint8_t index) {
+  return (uint16_t)modbus_buffer[index] << 8 | modbus_buffer[index + 1];
+}
+
+// Antwort mit Prüfsumme versehen und senden. Der Empfänger ist währenddessen aus,
+// damit das eigene Echo auf dem RS-485-Bus nicht als Anfrage gelesen wird.
+void modbusSend(uint8_t length) {
+  uint16_t crc = modbusCrc(modbus_buffer, length);
+  modbus_buffer[length++] = crc & 0xFF;
+  modbus_buffer[length++] = crc >> 8;
+  ModbusDePin::high();
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    modbus_length = length;
+    modbus_tx_index = 0;
+    modbus_state = MODBUS_TRANSMIT;
+    UCSR0B = (UCSR0B & ~_BV(RXEN0)) | _BV(UDRIE0);
+  }
+}
+
+static uint8_t modbusProcess(bool broadcast, uint8_t* response_length) {
+  uint8_t function = modbus_buffer[1];
+  uint16_t address = modbusWord(2);
+  uint16_t count = modbusWord(4);
+
+  switch (function) {
+    case 0x03:
+    case 0x04: {
+      if (broadcast) return MODBUS_EX_ILLEGAL_FUNCTION;
+      if (modbus_length != 8) return MODBUS_EX_ILLEGAL_VALUE;
+      if (count == 0 || count > MODBUS_MAX_READ) return MODBUS_EX_ILLEGAL_VALUE;
+      for (uint8_t i = 0; i < count; i++) {
+        uint16_t value;
+        uint8_t ex = modbusReadRegister(function == 0x04, address + i, &value);
+        if (ex) return ex;
+        modbus_buffer[3 + 2*i] = value >> 8;
+        modbus_buffer[4 + 2*i] = value & 0xFF;
+      }
+      modbus_buffer[2] = count * 2;
+      *response_length = 3 + count * 2;
+      return 0;
+    }
+    case 0x06: {
+      if (modbus_length != 8) return MODBUS_EX_ILLEGAL_VALUE;
+      uint8_t ex = modbusWriteRegister(address, count);
+      *response_length = 6;   // Antwort = Echo der Anfrage
+      return ex;
+    }
+    case 0x10: {
+      if (count == 0 || count > MODBUS_MAX_WRITE || modbus_buffer[6] != count * 2 || modbus_length != 9 + count * 2) {
+        return MODBUS_EX_ILLEGAL_VALUE;
+      }
+      for (uint8_t i = 0; i < count; i++) {
+        uint8_t ex = modbusWriteRegister(address + i, modbusWord(7 + 2*i));
+        if (ex) return ex;
+      }
+      *response_length = 6;   // Adresse + Anzahl bleiben im Puffer stehen
+      return 0;
+    }
+  }
+  return MODBUS_EX_ILLEGAL_FUNCTION;
+}
+
+// Liegt ein vollständiger Frame vor, wird er geprüft, ausgeführt und ggf. beantwortet.
+// Gibt true zurück, wenn ein an diese Adresse gerichteter Frame verarbeitet wurde.
+bool modbusPoll() {
+  if (modbus_state != MODBUS_FRAME) return false;
+
+  uint8_t length = modbus_length;
+  bool broadcast = modbus_buffer[0] == 0;
+  bool valid = true;      // Adresse und Mindestlänge hat schon der Timer-Interrupt geprüft
+  if (modbusCrc(modbus_buffer, length) != 0) {
+    modbus_counters.crc_errors++;
+    valid = false;
+  }
+
+  uint8_t response_length = 0;
+  if (valid) {
+    modbus_counters.frames++;
+    uint8_t ex = modbusProcess(broadcast, &response_length);
+    if (ex) {
+      modbus_counters.exceptions++;
+      modbus_buffer[1] |= 0x80;
+      modbus_buffer[2] = ex;
+      response_length = 3;
+    }
+  }
+
+  if (valid && !broadcast) modbusSend(response_length);
+  else {
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+      modbus_length = 0;
+      modbus_state = MODBUS_RECEIVE;
+    }
+  }
+  return valid;
+}
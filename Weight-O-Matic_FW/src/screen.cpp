@@ -0,0 +1,90 @@
+/* MIT License
+
+Copyright (c) 2024 mva-one
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ */
+
+
+#include "screen.h"
+
+static LCD_I2C* screen_lcd = nullptr;
+static char screen_shadow[SCREEN_ROWS][SCREEN_COLS];    // aktueller Inhalt des Displays
+static uint8_t screen_next_col = SCREEN_COLS;            // Schreibposition des Displays,
+static uint8_t screen_next_row = 0;                      // SCREEN_COLS = unbekannt
+
+void screenBegin(LCD_I2C* lcd) {
+  screen_lcd = lcd;
+}
+
+// Zeichen nur senden, wenn es sich vom Display-Inhalt unterscheidet
+static void screenPut(uint8_t col, uint8_t row, char c) {
+  if (col >= SCREEN_COLS || row >= SCREEN_ROWS || screen_shadow[row][col] == c) return;
+  if (col != screen_next_col || row != screen_next_row) screen_lcd->setCursor(col, row);
+  screen_lcd->write(c);
+  screen_shadow[row][col] = c;
+  screen_next_col = col + 1;
+  screen_next_row = row;
+}
+
+static bool screenItem(const ScreenItem*& layout, ScreenItem& item, uint8_t& col, uint8_t& row) {
+  memcpy_P(&item, layout++, sizeof(ScreenItem));
+  col = item.pos & 0x0F;
+  row = item.pos >> 4;
+  return item.type != SCREEN_END;
+}
+
+void screenDraw(const ScreenItem* layout) {
+  screen_lcd->clear();
+  memset(screen_shadow, ' ', sizeof(screen_shadow));
+  screen_next_col = 0;
+  screen_next_row = 0;
+
+  ScreenItem item;
+  uint8_t col, row;
+  while (screenItem(layout, item, col, row)) {
+    if (item.type == SCREEN_TEXT) {
+      const char* p = (const char*)txt((TextId)item.arg);
+      for (char c = pgm_read_byte(p); c != '\0'; c = pgm_read_byte(++p)) screenPut(col++, row, c);
+    }
+    else if (item.type == SCREEN_GLYPH) screenPut(col, row, item.arg);
+  }
+}
+
+void screenUpdate(const ScreenItem* layout, uint8_t selected) {
+  // andere Zeichenroutinen können die Schreibposition verändert haben
+  screen_next_col = SCREEN_COLS;
+
+  ScreenItem item;
+  uint8_t col, row;
+  while (screenItem(layout, item, col, row)) {
+    if (item.type == SCREEN_CURSOR) screenPut(col, row, item.arg == selected ? 0 : ' ');
+    else if (item.type == SCREEN_FIELD) {
+      char cells[SCREEN_FIELD_WIDTH_MAX];
+      if (!screenField(item.arg, cells)) continue;
+      for (uint8_t i = 0; i < item.width; i++) screenPut(col + i, row, cells[i]);
+    }
+  }
+
+  uint8_t pos = screenEditCursor();
+  if (pos == SCREEN_NO_CURSOR) return;
+  screen_lcd->setCursor(pos & 0x0F, pos >> 4);
+  screen_lcd->blink();
+  screen_next_col = SCREEN_COLS;
+}
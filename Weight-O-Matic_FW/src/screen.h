@@ -0,0 +1,92 @@
+/* MIT License
+
+Copyright (c) 2024 mva-one
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ */
+
+
+#pragma once
+
+#include <Arduino.h>
+#include <LCD_I2C.h>
+#include "texts.h"
+
+/*
+    Bildschirm-Layouts als Tabellen im Flash und ein gemeinsamer Renderer.
+
+    Ein Layout ist eine Liste von Elementen mit Position: statische Texte (TextId), einzelne
+    Zeichen (auch die eigenen Zeichen 0-7), Felder mit fester Breite, deren Inhalt screenField()
+    liefert, und Cursor-Plätze, an denen der Cursor (Zeichen 0) steht, wenn der Unterzustand
+    passt. screenDraw() zeichnet die statischen Elemente, screenUpdate() danach bei jeder
+    Aktualisierung Felder und Cursor und setzt zuletzt den blinkenden Eingabe-Cursor, den
+    screenEditCursor() liefert.
+
+    Der Renderer führt eine Kopie des Display-Inhalts im RAM und schickt nur Zeichen, die sich
+    geändert haben. Jedes Zeichen kostet über I2C ca. 0,5 ms, bei einem Gewichtswechsel ändern
+    sich meist nur ein bis zwei Stellen. setCursor() wird nur gesendet, wenn das nächste
+    geänderte Zeichen nicht direkt anschließt.
+ */
+
+#define SCREEN_COLS 16
+#define SCREEN_ROWS 2
+#define SCREEN_FIELD_WIDTH_MAX 16
+
+enum ScreenItemType : uint8_t {
+  SCREEN_END,
+  SCREEN_TEXT,      // arg: TextId
+  SCREEN_GLYPH,     // arg: Zeichen
+  SCREEN_FIELD,     // arg: Feld-ID, width: Anzahl Zeichen (max. SCREEN_FIELD_WIDTH_MAX)
+  SCREEN_CURSOR,    // arg: Unterzustand, bei dem hier der Cursor steht
+};
+
+struct ScreenItem {
+  ScreenItemType type;
+  uint8_t pos;      // Spalte | Zeile << 4
+  uint8_t arg;
+  uint8_t width;
+};
+
+#define SCREEN_POS(col, row) ((col) | (row) << 4)
+
+// Kurzschreibweise für die Layout-Tabellen
+#define S_TEXT(col, row, id)              { SCREEN_TEXT, SCREEN_POS(col, row), id, 0 }
+#define S_GLYPH(col, row, c)              { SCREEN_GLYPH, SCREEN_POS(col, row), c, 1 }
+#define S_FIELD(col, row, field, width)   { SCREEN_FIELD, SCREEN_POS(col, row), field, width }
+#define S_CURSOR(col, row, sub)           { SCREEN_CURSOR, SCREEN_POS(col, row), sub, 1 }
+#define S_END                             { SCREEN_END, 0, 0, 0 }
+
+// Inhalt des Felds field als width Zeichen nach cells schreiben, wird von der Firmware
+// bereitgestellt. Bei false wird das Feld nicht gezeichnet, der statische Inhalt bleibt stehen.
+bool screenField(uint8_t field, char* cells);
+
+#define SCREEN_NO_CURSOR 0xFF
+
+// Position (SCREEN_POS) des blinkenden Eingabe-Cursors, SCREEN_NO_CURSOR = keiner. Wird von der
+// Firmware bereitgestellt.
+uint8_t screenEditCursor();
+
+void screenBegin(LCD_I2C* lcd);
+
+// Display löschen und die statischen Elemente des Layouts zeichnen
+void screenDraw(const ScreenItem* layout);
+
+// Felder und Cursor (selected = aktueller Unterzustand) aktualisieren, nur geänderte Zeichen senden,
+// danach den Eingabe-Cursor setzen
+void screenUpdate(const ScreenItem* layout, uint8_t selected);
@@ -0,0 +1,38 @@
+/* MIT License
+
+Copyright (c) 2024 mva-one
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ */
+
+#include "texts.h"
+
+#define TEXT_STRING(id, text) static const char id##_string[] PROGMEM = text;
+TEXT_TABLE(TEXT_STRING)
+#undef TEXT_STRING
+
+static const char* const text_table[] PROGMEM = {
+  #define TEXT_POINTER(id, text) id##_string,
+  TEXT_TABLE(TEXT_POINTER)
+  #undef TEXT_POINTER
+};
+
+const __FlashStringHelper* txt(TextId id) {
+  return (const __FlashStringHelper*)pgm_read_ptr(&text_table[id]);
+}
@@ -0,0 +1,183 @@
+/* MIT License
+
+Copyright (c) 2024 mva-one
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+
+#define VERSION "v0.8"
+
+/*
+    Alle Texte für LCD und Serielle Konsole liegen im Flash (PROGMEM) und werden über ihre ID
+    angesprochen. Mehrfach verwendete Texte (z.B. die Kopfzeile der Hauptbildschirme) sind
+    so nur einmal im Flash abgelegt. Ausgabe z.B. mit lcd.print(txt(TXT_HEADER)).
+ */
+#define TEXT_TABLE(X) \
+  X(TXT_TITLE,                    " Weight-O-Matic ") \
+  X(TXT_VERSION,                  VERSION) \
+  X(TXT_STARTING_LCD,             "Starte...") \
+  X(TXT_ERROR,                    "FEHLER") \
+  X(TXT_RESET,                    " RESET") \
+  X(TXT_FAULT_TIMEOUT,            "kein Messwert") \
+  X(TXT_FAULT_RAIL,               "ADC am Endwert") \
+  X(TXT_FAULT_STUCK,              "Messwert haengt") \
+  X(TXT_FAULT_STEP,               "Messwert springt") \
+  X(TXT_FAULT_FROZEN,             "kein Anstieg") \
+  X(TXT_UNLOAD,                   "Waage entlasten!") \
+  X(TXT_TARE_HINT,                "(Tara)") \
+  X(TXT_NEXT,                     " weiter") \
+  X(TXT_WAIT,                     " Bitte warten!  ") \
+  X(TXT_PLACE_MASS,               "Bek. Masse aufl.") \
+  X(TXT_CAL_HINT,                 "(Kal.)") \
+  X(TXT_KNOWN_MASS,               "Bekannte Masse:") \
+  X(TXT_CAL_POINT,                "Punkt ") \
+  X(TXT_CAL_POINT_DONE,           " erfasst") \
+  X(TXT_CAL_POINT_REJECTED,       " Fehler") \
+  X(TXT_CAL_MORE,                 "  weiter fertig") \
+  X(TXT_SAVE_CAL,                 "Kal. speichern?") \
+  X(TXT_SAVE_TARE,                "Tara speichern?") \
+  X(TXT_YES_NO,                   "Ja     Nein") \
+  X(TXT_HEADER,                   "  --.-/--.-  VE") \
+  X(TXT_START_TV,                 "  START  TV-.--") \
+  X(TXT_START_SETTINGS,           "  START   Einst.") \
+  X(TXT_ACTIVE,                   "  aktiv   STOPP!") \
+  X(TXT_TOPUP_LABEL,              "NF ") \
+  X(TXT_DONE,                     "--min--s  fertig") \
+  X(TXT_SETTINGS_TOGGLES,         "TT    ET") \
+  X(TXT_SETTINGS_ACTIONS,         "TARA  KALI  RST") \
+  X(TXT_SETTINGS_TOGGLES_2,       "AZ    GW") \
+  X(TXT_SETTINGS_TOGGLES_3,       "NF    TEST  PAR") \
+  X(TXT_SETTINGS_ACTIONS_3,       "REZ   GEN") \
+  X(TXT_NOISE_RUNNING,            "Rauschtest") \
+  X(TXT_NOISE_HINT,               "nicht belasten") \
+  X(TXT_NOISE_SAVE,               "Fenst.?  nein ja") \
+  X(TXT_AUTOCYCLE_DONE,           "fertig") \
+  X(TXT_AUTOCYCLE_WAITING,        "Beh.? ") \
+  X(TXT_AUTOCYCLE_START,          "Start") \
+  X(TXT_RESET_QUESTION,           " ZURUECKSETZEN? ") \
+  X(TXT_RESET_SURE,               "Sicher?  nee  ja") \
+  X(TXT_RESUME_SURE,              "Weiter?  nein ja") \
+  X(TXT_DEGRADED,                 "!NOTBETRIEB! VE") \
+  X(TXT_DEGRADED_START,           "  START  ~    kg") \
+  X(TXT_DEGRADED_ACTIVE,          "    s     STOPP!") \
+  X(TXT_RECIPE_ENTRY,             "Rezept # (# S.)") \
+  X(TXT_RECIPE_HINT,              "  Start: OKK") \
+  X(TXT_RECIPE_HEADER,            "  --.-/--.- S / ") \
+  X(TXT_RECIPE_ACTIVE,            "A         STOPP!") \
+  X(TXT_RECIPE_TARE,              "Tara") \
+  X(TXT_RECIPE_FILL,              "aktiv") \
+  X(TXT_RECIPE_SETTLE,            "Pause") \
+  X(TXT_RECIPE_RESULT_TARGET,     " S  Soll      kg") \
+  X(TXT_RECIPE_RESULT_ACTUAL,     "Ist           kg") \
+  X(TXT_OVERSHOOT_HEAD,           "VE  n    ^") \
+  X(TXT_OVERSHOOT_STATS,          "M      s      kg") \
+  X(TXT_KG,                       " kg ") \
+  X(TXT_OUTPUT_OFF,               "Ausgang deaktiviert.") \
+  X(TXT_OUTPUT_ON,                "Ausgang aktiviert.") \
+  X(TXT_STATE_TRANSITION,         "State transition to ") \
+  X(TXT_TURN_LEFT,                "Rotary turned left.") \
+  X(TXT_TURN_RIGHT,               "Rotary turned right.") \
+  X(TXT_CLICK_SHORT,              "Rotary button short click.") \
+  X(TXT_CLICK_LONG,               "Rotary button long click.") \
+  X(TXT_SWITCH_CHANGED,           "Switch changed to position ") \
+  X(TXT_STARTING,                 "Starting...") \
+  X(TXT_NO_CAL,                   "Keine Kalibrierungswerte im EEPROM gefunden, Standardwerte geladen!") \
+  X(TXT_NO_SETTINGS,              "Keine gespeicherten allg. Einstellungen im EEPROM gefunden, Standardwerte geladen!") \
+  X(TXT_NO_P1,                    "Keine gespeicherten Einstellungen für VE 1 im EEPROM gefunden, Standardwerte geladen!") \
+  X(TXT_NO_P2,                    "Keine gespeicherten Einstellungen für VE 2 im EEPROM gefunden, Standardwerte geladen!") \
+  X(TXT_CAL_LOADED,               "Kalibrierungswerte aus EEPROM erfolgreich geladen: ") \
+  X(TXT_SETTINGS_LOADED,          "Gespeicherte allg. Einstellungen erfolgreich geladen: ") \
+  X(TXT_P1_LOADED,                "Gespeicherte Einstellungen für VE 1 erfolgreich geladen!") \
+  X(TXT_P2_LOADED,                "Gespeicherte Einstellungen für VE 2 erfolgreich geladen!") \
+  X(TXT_HX711_ERROR,              "Fehler bei der Verbindung MCU <-> HX711.") \
+  X(TXT_HX711_OK,                 "Wiegezelle erfolgreich initialisiert.") \
+  X(TXT_SETTINGS_SAVED,           "(28) Einstellungen im EEPROM gespeichert: ") \
+  X(TXT_RESET_DONE,               "(29) Es wurde alles zurückgesetzt. Starte neu...") \
+  X(TXT_TARE_41,                  "(41) Tara abgeschlossen. Neuer Wert für tara_offset: ") \
+  X(TXT_CAL_DONE,                 "(61) Kalibrierpunkt erfasst. cal_value / Rohwert / Masse: ") \
+  X(TXT_CAL_REJECTED,             "(61) Kalibrierpunkt verworfen (Rohwert/Masse nicht streng steigend). cal_value / Rohwert / Masse: ") \
+  X(TXT_CAL_SAVED,                "(71) Kalibrierungswerte im EEPROM gespeichert: ") \
+  X(TXT_TARE_91,                  "(91) Tara abgeschlossen. Neuer Wert für tara_offset: ") \
+  X(TXT_TARE_SAVED,               "(101) Tara-Offset im EEPROM gespeichert: ") \
+  X(TXT_P1_SAVED,                 "(151) Sollwert / Tara-Versatz für VE 1 im EEPROM gespeichert: ") \
+  X(TXT_P2_SAVED,                 "(201) Sollwert / Tara-Versatz für VE 2 im EEPROM gespeichert: ") \
+  X(TXT_SEPARATOR,                " / ") \
+  X(TXT_TASK,                     "Task ") \
+  X(TXT_COLON,                    ": ") \
+  X(TXT_TASK_STATS,               " Fristüberschreitungen, max. Laufzeit ") \
+  X(TXT_US,                       " us") \
+  X(TXT_RAM_STATIC,               "RAM statisch (Bytes): ") \
+  X(TXT_RAM_STACK_MAX,            "Stack max. (Bytes): ") \
+  X(TXT_RAM_FREE_MIN,             "RAM min. frei (Bytes): ") \
+  X(TXT_EEPROM_QUEUE_STATS,       "EEPROM-Bytes geschrieben / übersprungen, Wartefälle: ") \
+  X(TXT_UNKNOWN_COMMAND,          "Unbekannter Befehl: ") \
+  X(TXT_AUTOCYCLE_STARTED,        "Auto-Zyklus: leerer Behälter erkannt, starte.") \
+  X(TXT_BROWNOUT,                 "Neustart nach Brown-out (Unterspannung).") \
+  X(TXT_JOURNAL_FOUND,            "Unterbrochene Befüllung im Journal (VE / netto / Sollwert): ") \
+  X(TXT_JOURNAL_RESUME,           "(31) Setze unterbrochene Befüllung fort, bisherige Füllzeit ms: ") \
+  X(TXT_TOPUP_CYCLE,              "Nachfüllen: Zyklus / netto / Dauer ms: ") \
+  X(TXT_TOPUP_REOPEN,             "Nachfüllen: unter Schaltschwelle, Ventil öffnet.") \
+  X(TXT_NOISE_RESULT_RATE,        "(32) Rauschtest: Messwerte / Rate Hz: ") \
+  X(TXT_NOISE_RESULT_RAW,         "Mittelwert / Std.-Abw. / Spitze-Spitze (Rohwert): ") \
+  X(TXT_NOISE_RESULT_BITS,        "Std.-Abw. g / Ausreißer / ENOB / rauschfreie Bits: ") \
+  X(TXT_NOISE_RESULT_WINDOW,      "Vorgeschlagenes Filterfenster (Messwerte): ") \
+  X(TXT_NOISE_WINDOW_LIMIT,       " (Vorgabe nicht erreichbar)") \
+  X(TXT_FILTER_SAVED,             "(34) Filterfenster gespeichert: ") \
+  X(TXT_FILTER_LOADED,            "Filterfenster (Messwerte): ") \
+  X(TXT_CURVE_HEADER,             "# Füllkurve (Nr. / VE / Sollwert g / Intervall s / Flags 1=Abbruch 2=gekürzt): ") \
+  X(TXT_CURVE_COLUMNS,            "t_s;netto_g") \
+  X(TXT_CURVE_NONE,               "Keine Füllkurven gespeichert.") \
+  X(TXT_CURVE_INTERVAL,           "Füllkurven-Intervall s: ") \
+  X(TXT_CONTAINER_MATCH,          "Behälter erkannt (Nr. / Tara g / Sollwert g): ") \
+  X(TXT_CONTAINER_AMBIGUOUS,      "Behälter nicht eindeutig, Start gesperrt. Gewicht g: ") \
+  X(TXT_CONTAINER_LIST,           "Behälter Nr. / Tara g / Toleranz g / Sollwert g: ") \
+  X(TXT_PARAM,                    "Parameter (Nr. / Name / Wert / min / max / Vorgabe): ") \
+  X(TXT_PARAM_UNKNOWN,            "Unbekannter Parameter oder Wert außerhalb des Bereichs: ") \
+  X(TXT_PARAM_SAVED,              "(36) Parameter gespeichert: ") \
+  X(TXT_NO_PARAMS,                "Keine gespeicherten Parameter im EEPROM gefunden, Standardwerte geladen!") \
+  X(TXT_DEGRADED_ENTER,           "Wiegezelle ausgefallen, Notbetrieb (VE / Menge g / Füllzeit ms): ") \
+  X(TXT_DEGRADED_DONE,            "(38) Notbetrieb: Befüllung beendet (STOPP / Füllzeit ms): ") \
+  X(TXT_DEGRADED_END,             "Wiegezelle liefert wieder Messwerte, Notbetrieb beendet.") \
+  X(TXT_FLOW_LIST,                "Füllrate VE / g/s / gelernte Befüllungen: ") \
+  X(TXT_LOADCELL_FAULT,           "Wiegezelle gestört, Fehler E / Rohwert: ") \
+  X(TXT_RECIPE_LIST,              "Rezept / Schritt / Ausgang / Sollwert g / Pause s: ") \
+  X(TXT_RECIPE_STEP_DONE,         "(40) Rezept-Schritt / Sollwert g / Ist g / Dauer ms: ") \
+  X(TXT_SETTLED,                  "Nachlauf erfasst (VE / Abschaltwert g / Endwert g / Überschwingen g): ") \
+  X(TXT_SETTLE_FAILED,            "Nachlauf nicht erfasst (kein Stillstand oder Behälter entnommen).") \
+  X(TXT_OVERSHOOT_LIST,           "Überschwingen VE / Anzahl / Mittel g / Std.-Abw. g / max. g: ") \
+  X(TXT_CAPTURE_HEADER,           "Aufzeichnung am Abschaltpunkt VE / Sollwert g / Messwerte / davor: ") \
+  X(TXT_CAPTURE_COLUMNS,          "ms;Rohwert;g") \
+  X(TXT_CAPTURE_EDGE,             "0;Ausgang aus") \
+  X(TXT_CAPTURE_NONE,             "Keine Aufzeichnung im EEPROM.") \
+  X(TXT_CAPTURE_SAVED,            "Aufzeichnung am Abschaltpunkt gespeichert, Messwerte: ") \
+  X(TXT_CAPTURE_UNSAVED,          "Nicht im EEPROM gespeichert, sichern mit \"capture save\".") \
+  X(TXT_CAPTURE_NOTHING_TO_SAVE,  "Keine ungespeicherte Aufzeichnung.")
+
+enum TextId : uint8_t {
+  #define TEXT_ID(id, text) id,
+  TEXT_TABLE(TEXT_ID)
+  #undef TEXT_ID
+  TXT_COUNT
+};
+
+const __FlashStringHelper* txt(TextId id);
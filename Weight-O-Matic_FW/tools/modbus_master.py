@@ -0,0 +1,262 @@
+#!/usr/bin/env python3
+"""
+Modbus-RTU-Master zum Testen der Weight-O-Matic-Firmware (MODBUS_ENABLED), als Ersatz für die SPS.
+
+Nur Python-Standardbibliothek. Verbindung entweder über eine serielle Schnittstelle bzw. ein
+vorhandenes pty (z.B. von einem Simulator) mit --port, oder mit --pty über ein neu angelegtes
+Pseudo-Terminal, dessen Name ausgegeben wird (z.B. für simavr/uart_pty oder socat).
+
+Beispiele:
+  modbus_master.py --port /dev/ttyUSB0 status
+  modbus_master.py --port /dev/ttyUSB0 --node 3 read-input 0 20
+  modbus_master.py --port /dev/ttyUSB0 set p1_target 12500
+  modbus_master.py --port /dev/ttyUSB0 start
+  modbus_master.py --port /dev/ttyUSB0 --node 0 set-node 5    (Broadcast, nur ein Gerät am Bus!)
+  modbus_master.py --pty scan
+"""
+
+import argparse
+import os
+import pty
+import select
+import struct
+import sys
+import termios
+import time
+import tty
+
+BAUD = 19200
+CHAR_S = 11.0 / BAUD
+T35_S = 3.5 * CHAR_S
+
+# Registerbelegung, siehe Abschnitt "Modbus RTU" in src/main.cpp
+INPUT_REGISTERS = [
+    ("state", 0, 1), ("sub_state", 1, 1), ("gross_g", 2, 2), ("net_g", 4, 2), ("flags", 6, 1),
+    ("switch", 7, 1), ("last_target_g", 8, 2), ("last_done_g", 10, 2), ("last_duration_ms", 12, 2),
+    ("fill_count", 14, 2), ("bus_frames", 16, 1), ("bus_crc_errors", 17, 1),
+    ("bus_frame_errors", 18, 1), ("bus_exceptions", 19, 1), ("topup_cycles", 20, 2), ("fault", 22, 1),
+]
+HOLDING_REGISTERS = {
+    "p1_target": 0, "p1_offset": 2, "p2_target": 4, "p2_offset": 6, "p0_target": 8,
+}
+REG_COMMAND = 10
+REG_NODE = 11
+COMMANDS = {"start": 1, "stop": 2, "save": 3}
+FLAGS = ["output", "stable", "warm", "stop_latched", "journal", "topup", "topup_waiting", "container_ambiguous", "degraded"]
+EXCEPTIONS = {1: "illegal function", 2: "illegal address", 3: "illegal value", 4: "device failure"}
+
+
+class ModbusError(Exception):
+    pass
+
+
+def crc16(data):
+    crc = 0xFFFF
+    for b in data:
+        crc ^= b
+        for _ in range(8):
+            crc = (crc >> 1) ^ 0xA001 if crc & 1 else crc >> 1
+    return crc
+
+
+def open_port(path):
+    fd = os.open(path, os.O_RDWR | os.O_NOCTTY)
+    configure(fd)
+    return fd
+
+
+def configure(fd):
+    tty.setraw(fd)
+    attrs = termios.tcgetattr(fd)
+    attrs[2] |= termios.PARENB | termios.CLOCAL | termios.CREAD
+    attrs[2] &= ~(termios.PARODD | termios.CSTOPB)
+    attrs[4] = attrs[5] = getattr(termios, "B%d" % BAUD)
+    try:
+        termios.tcsetattr(fd, termios.TCSANOW, attrs)
+    except termios.error:
+        pass   # pty ohne Baudrate/Parität
+
+
+class Master:
+    def __init__(self, fd, node, timeout):
+        self.fd = fd
+        self.node = node
+        self.timeout = timeout
+
+    def transact(self, pdu):
+        frame = bytes([self.node]) + pdu
+        frame += struct.pack("<H", crc16(frame))
+        if os.isatty(self.fd):
+            termios.tcflush(self.fd, termios.TCIFLUSH)
+        time.sleep(T35_S)
+        os.write(self.fd, frame)
+        if self.node == 0:
+            time.sleep(0.1)   # Broadcast: keine Antwort
+            return None
+        return self.receive()
+
+    def receive(self):
+        data = b""
+        deadline = time.monotonic() + self.timeout
+        while True:
+            # bis zur ersten Antwort max. timeout, danach Frame-Ende nach 3,5 Zeichen Ruhe
+            wait = deadline - time.monotonic() if not data else max(T35_S, 0.005)
+            if wait <= 0:
+                raise ModbusError("Timeout, keine Antwort von Knoten %d" % self.node)
+            ready, _, _ = select.select([self.fd], [], [], wait)
+            if not ready:
+                if data:
+                    break
+                continue
+            data += os.read(self.fd, 256)
+        if len(data) < 5 or crc16(data) != 0:
+            raise ModbusError("ungültige Antwort: %s" % data.hex(" "))
+        if data[0] != self.node:
+            raise ModbusError("Antwort von falschem Knoten %d" % data[0])
+        if data[1] & 0x80:
+            code = data[2]
+            raise ModbusError("Exception %d (%s)" % (code, EXCEPTIONS.get(code, "?")))
+        return data[1:-2]
+
+    def read(self, function, address, count):
+        reply = self.transact(struct.pack(">BHH", function, address, count))
+        if reply[1] != 2 * count:
+            raise ModbusError("falsche Länge in der Antwort")
+        return list(struct.unpack(">%dH" % count, reply[2:2 + 2 * count]))
+
+    def write_single(self, address, value):
+        self.transact(struct.pack(">BHH", 0x06, address, value & 0xFFFF))
+
+    def write_multiple(self, address, values):
+        pdu = struct.pack(">BHHB", 0x10, address, len(values), 2 * len(values))
+        pdu += struct.pack(">%dH" % len(values), *[v & 0xFFFF for v in values])
+        self.transact(pdu)
+
+    def write_long(self, address, value):
+        value &= 0xFFFFFFFF
+        self.write_multiple(address, [value >> 16, value & 0xFFFF])
+
+
+def to_long(high, low):
+    value = high << 16 | low
+    return value - (1 << 32) if value & 0x80000000 else value
+
+
+def cmd_status(master, args):
+    regs = master.read(0x04, 0, 23)
+    for name, address, size in INPUT_REGISTERS:
+        value = regs[address] if size == 1 else to_long(regs[address], regs[address + 1])
+        if name == "flags":
+            value = "%d (%s)" % (value, ", ".join(f for i, f in enumerate(FLAGS) if value >> i & 1) or "-")
+        print("%-18s %s" % (name, value))
+    regs = master.read(0x03, 0, 12)
+    for name, address in HOLDING_REGISTERS.items():
+        print("%-18s %d" % (name, to_long(regs[address], regs[address + 1])))
+    print("%-18s %d" % ("node", regs[REG_NODE]))
+
+
+def cmd_read(function):
+    def run(master, args):
+        for i, value in enumerate(master.read(function, args.address, args.count)):
+            print("%5d  %5d  0x%04x" % (args.address + i, value, value))
+    return run
+
+
+def cmd_write(master, args):
+    if len(args.values) == 1:
+        master.write_single(args.address, args.values[0])
+    else:
+        master.write_multiple(args.address, args.values)
+
+
+def cmd_set(master, args):
+    master.write_long(HOLDING_REGISTERS[args.name], args.value)
+
+
+def cmd_command(name):
+    def run(master, args):
+        master.write_single(REG_COMMAND, COMMANDS[name])
+    return run
+
+
+def cmd_set_node(master, args):
+    master.write_single(REG_NODE, args.address)
+
+
+def cmd_scan(master, args):
+    old_timeout = master.timeout
+    master.timeout = 0.05
+    for node in range(1, 248):
+        master.node = node
+        try:
+            state = master.read(0x04, 0, 1)[0]
+            print("Knoten %3d: Zustand %d" % (node, state))
+        except ModbusError:
+            pass
+    master.timeout = old_timeout
+
+
+def cmd_monitor(master, args):
+    while True:
+        regs = master.read(0x04, 0, 8)
+        print("Zustand %3d  brutto %7d g  netto %7d g  Status 0x%02x" % (
+            regs[0], to_long(regs[2], regs[3]), to_long(regs[4], regs[5]), regs[6]), flush=True)
+        time.sleep(args.interval)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    group = parser.add_mutually_exclusive_group(required=True)
+    group.add_argument("--port", help="serielle Schnittstelle bzw. pty des Simulators")
+    group.add_argument("--pty", action="store_true", help="neues Pseudo-Terminal anlegen und Namen ausgeben")
+    parser.add_argument("--node", type=int, default=1, help="Knotenadresse (0 = Broadcast), Standard 1")
+    parser.add_argument("--timeout", type=float, default=0.5, help="Antwort-Timeout in s")
+    sub = parser.add_subparsers(dest="command", required=True)
+
+    sub.add_parser("status", help="alle Register lesen und anzeigen").set_defaults(run=cmd_status)
+    for name, function in (("read-input", 0x04), ("read-holding", 0x03)):
+        p = sub.add_parser(name, help="Register lesen (FC %02d)" % function)
+        p.add_argument("address", type=int)
+        p.add_argument("count", type=int, nargs="?", default=1)
+        p.set_defaults(run=cmd_read(function))
+    p = sub.add_parser("write", help="Register schreiben (FC 06 bzw. 16 bei mehreren Werten)")
+    p.add_argument("address", type=int)
+    p.add_argument("values", type=int, nargs="+")
+    p.set_defaults(run=cmd_write)
+    p = sub.add_parser("set", help="32-Bit-Voreinstellung schreiben (Gramm)")
+    p.add_argument("name", choices=HOLDING_REGISTERS.keys())
+    p.add_argument("value", type=int)
+    p.set_defaults(run=cmd_set)
+    for name in COMMANDS:
+        sub.add_parser(name, help="Befehl %s senden" % name.upper()).set_defaults(run=cmd_command(name))
+    p = sub.add_parser("set-node", help="Knotenadresse ändern (wird im EEPROM gespeichert)")
+    p.add_argument("address", type=int)
+    p.set_defaults(run=cmd_set_node)
+    sub.add_parser("scan", help="Adressen 1-247 abfragen").set_defaults(run=cmd_scan)
+    p = sub.add_parser("monitor", help="Zustand und Gewicht zyklisch ausgeben")
+    p.add_argument("--interval", type=float, default=0.5)
+    p.set_defaults(run=cmd_monitor)
+
+    args = parser.parse_args()
+
+    if args.pty:
+        fd, slave_fd = pty.openpty()
+        configure(slave_fd)
+        print("pty: %s" % os.ttyname(slave_fd), file=sys.stderr)
+        input("Simulator mit diesem pty verbinden, dann Enter...")
+    else:
+        fd = open_port(args.port)
+
+    master = Master(fd, args.node, args.timeout)
+    try:
+        args.run(master, args)
+    except ModbusError as e:
+        print("Fehler: %s" % e, file=sys.stderr)
+        return 1
+    except KeyboardInterrupt:
+        pass
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
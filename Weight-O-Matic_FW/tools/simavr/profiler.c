@@ -0,0 +1,531 @@
+/* MIT License
+
+Copyright (c) 2024 mva-one
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ */
+
+/*
+    Zyklengenaue Profilierung des echten Firmware-Images (nanoatmega328new) in simavr.
+
+    Aufruf:  profiler <firmware.elf> <firmware.sym> <szenario.txt>
+
+    firmware.sym ist die Ausgabe von "avr-nm -n -C --defined-only firmware.elf" (siehe run.sh).
+    Simuliert werden:
+      - HX711 an D11 (DOUT) / D10 (SCK): Wandlung mit 10 bzw. 80 Hz, 24 Bit bit-banged,
+        Rohwert = Tara + Masse x Kalibrierungsfaktor (Standardwerte wie in main.cpp), plus
+        "noise". Ohne Rauschen sind die Rohwerte konstant und die Firmware meldet E3.
+      - LCD über PCF8574 (I2C 0x27): HD44780 im 4-Bit-Modus wird dekodiert, "screen" gibt es aus
+      - Dreh-Drück-Knopf an D3 / D4 / D2, VE-Wahl-Schalter an D5 / D7
+      - Befüllung: solange der Ausgang D8 high ist, steigt die Masse um "flow" g/s
+
+    Die CPU wird Befehl für Befehl ausgeführt. Die Zyklen jedes Befehls werden der Funktion
+    zugerechnet, in der er liegt (Self-Zyklen). Für loop() und alle ISRs (__vector_N) wird
+    zusätzlich die Dauer pro Aufruf gemessen: vom Einsprung bis der Stackpointer wieder über
+    dem Wert beim Einsprung liegt (ret/reti). Bei loop() sind Interrupts darin enthalten.
+
+    Latenz: zu jeder fallenden Flanke an D8 wird die Zeit seit dem Ende des letzten
+    HX711-Lesevorgangs (reine Firmware-Latenz) ausgegeben und, wenn im Szenario "target"
+    gesetzt ist, die Zeit seit die tatsächliche Masse den Sollwert überschritten hat
+    (inkl. Wandlungsrate und gleitendem Mittelwert).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include <simavr/sim_avr.h>
+#include <simavr/sim_elf.h>
+#include <simavr/sim_irq.h>
+#include <simavr/avr_ioport.h>
+#include <simavr/avr_twi.h>
+
+#define F_CPU 16000000UL
+#define CYCLES_PER_MS (F_CPU / 1000)
+
+#define MAX_FUNCS 1024
+#define MAX_FRAMES 16
+#define MAX_ACTIONS 256
+
+/* ===== Symbole und Zyklenzählung ===== */
+
+typedef struct {
+  uint32_t addr;
+  char name[80];
+  uint64_t self_cycles;
+  uint32_t calls;
+  int tracked;              // loop() oder ISR: Dauer pro Aufruf messen
+  uint64_t incl_total, incl_min, incl_max;
+  uint32_t incl_count;
+} func_t;
+
+typedef struct {
+  int func;
+  uint64_t start;
+  uint16_t sp;
+} frame_t;
+
+static func_t funcs[MAX_FUNCS];
+static int nfuncs = 0;
+static frame_t frames[MAX_FRAMES];
+static int nframes = 0;
+
+static int cmp_func(const void* a, const void* b) {
+  const func_t* fa = a;
+  const func_t* fb = b;
+  return fa->addr < fb->addr ? -1 : fa->addr > fb->addr;
+}
+
+static void load_symbols(const char* path) {
+  FILE* f = fopen(path, "r");
+  if (!f) { perror(path); exit(1); }
+  char line[256];
+  while (fgets(line, sizeof(line), f) && nfuncs < MAX_FUNCS) {
+    unsigned int addr;
+    char type;
+    int n;
+    if (sscanf(line, "%x %c %n", &addr, &type, &n) < 2) continue;
+    if (type != 'T' && type != 't' && type != 'W' && type != 'w') continue;
+    if (addr >= 0x800000) continue;   // RAM/EEPROM-Bereich
+    func_t* fn = &funcs[nfuncs++];
+    memset(fn, 0, sizeof(*fn));
+    fn->addr = addr;
+    strncpy(fn->name, line + n, sizeof(fn->name) - 1);
+    fn->name[strcspn(fn->name, "\n")] = 0;
+    fn->incl_min = UINT64_MAX;
+    fn->tracked = strcmp(fn->name, "loop") == 0 || strcmp(fn->name, "loop()") == 0
+               || strncmp(fn->name, "__vector_", 9) == 0;
+  }
+  fclose(f);
+  qsort(funcs, nfuncs, sizeof(func_t), cmp_func);
+}
+
+static int find_func(uint32_t pc) {
+  int lo = 0, hi = nfuncs - 1, found = -1;
+  while (lo <= hi) {
+    int mid = (lo + hi) / 2;
+    if (funcs[mid].addr <= pc) { found = mid; lo = mid + 1; }
+    else hi = mid - 1;
+  }
+  return found;
+}
+
+static uint16_t read_sp(avr_t* avr) {
+  return avr->data[R_SPL] | (avr->data[R_SPH] << 8);
+}
+
+// nach jedem Befehl: Zyklen zuordnen, Einsprünge zählen, beendete loop()/ISR-Aufrufe abschließen
+static void account(avr_t* avr, uint32_t pc_before, uint64_t cycles) {
+  int f = find_func(pc_before);
+  if (f >= 0) funcs[f].self_cycles += cycles;
+
+  uint16_t sp = read_sp(avr);
+  while (nframes > 0 && sp > frames[nframes - 1].sp) {
+    frame_t* fr = &frames[--nframes];
+    func_t* fn = &funcs[fr->func];
+    uint64_t d = avr->cycle - fr->start;
+    fn->incl_total += d;
+    fn->incl_count++;
+    if (d < fn->incl_min) fn->incl_min = d;
+    if (d > fn->incl_max) fn->incl_max = d;
+  }
+
+  f = find_func(avr->pc);
+  if (f >= 0 && funcs[f].addr == avr->pc) {
+    funcs[f].calls++;
+    if (funcs[f].tracked && nframes < MAX_FRAMES) {
+      frames[nframes].func = f;
+      frames[nframes].start = avr->cycle;
+      frames[nframes].sp = sp;
+      nframes++;
+    }
+  }
+}
+
+/* ===== Peripherie ===== */
+
+typedef struct {
+  avr_irq_t* dout;
+  int sck;
+  int bit;                  // nächstes auszugebendes Bit, 24 = fertig, -1 = keine Wandlung bereit
+  uint32_t data;
+  uint64_t t_next_conversion;
+  uint64_t t_last_read_done;
+  int rate_hz;
+  long tare;
+  double cal;
+  double noise_g;
+} hx711_t;
+
+typedef struct {
+  avr_irq_t* irq;           // [TWI_IRQ_INPUT], [TWI_IRQ_OUTPUT]
+  int selected;
+  uint8_t last;
+  int four_bit;
+  int nibble_high;
+  uint8_t pending;
+  int addr;
+  int cgram;
+  char ddram[2][16];
+} lcd_t;
+
+static hx711_t hx;
+static lcd_t lcd;
+static avr_irq_t* pin_clk;
+static avr_irq_t* pin_dat;
+static avr_irq_t* pin_btn;
+static avr_irq_t* pin_sw1;
+static avr_irq_t* pin_sw2;
+
+static double mass_g = 0;
+static double flow_gps = 0;
+static double target_g = -1;
+static uint64_t t_target_crossed = 0;
+static int output_state = 0;
+static uint32_t output_edges = 0;
+
+static double now_mass(void) {
+  double n = hx.noise_g > 0 ? ((double)rand() / RAND_MAX * 2 - 1) * hx.noise_g : 0;
+  return mass_g + n;
+}
+
+static void hx711_conversion(avr_t* avr) {
+  if (hx.bit >= 0 && hx.bit < 24) return;   // Lesevorgang läuft, Wert nicht überschreiben
+  long raw = hx.tare + (long)(now_mass() * hx.cal);
+  hx.data = ((uint32_t)raw ^ 0x800000) & 0xFFFFFF;
+  hx.bit = 0;
+  avr_raise_irq(hx.dout, 0);   // DOUT low = Messwert bereit
+}
+
+static void hx711_sck_hook(struct avr_irq_t* irq, uint32_t value, void* param) {
+  avr_t* avr = param;
+  if (value && !hx.sck && hx.bit >= 0) {
+    // steigende Flanke: nächstes Bit ausgeben, nach dem 25. Takt DOUT high bis zur nächsten Wandlung
+    if (hx.bit < 24) {
+      avr_raise_irq(hx.dout, (hx.data >> (23 - hx.bit)) & 1);
+      hx.bit++;
+    } else {
+      avr_raise_irq(hx.dout, 1);
+      hx.bit = -1;
+      hx.t_last_read_done = avr->cycle;
+    }
+  }
+  hx.sck = value;
+}
+
+static void output_hook(struct avr_irq_t* irq, uint32_t value, void* param) {
+  avr_t* avr = param;
+  if (value == (uint32_t)output_state) return;
+  output_state = value;
+  output_edges++;
+  double t_ms = (double)avr->cycle / CYCLES_PER_MS;
+  printf("[%9.3f ms] Ausgang %s, Masse %.1f g\n", t_ms, value ? "AN" : "AUS", mass_g);
+  if (!value) {
+    uint64_t d = avr->cycle - hx.t_last_read_done;
+    printf("             Latenz letzter Messwert -> Flanke: %llu Zyklen (%.1f us)\n",
+           (unsigned long long)d, d * 1e6 / F_CPU);
+    if (t_target_crossed) {
+      d = avr->cycle - t_target_crossed;
+      printf("             Latenz Sollwert überschritten -> Flanke: %llu Zyklen (%.2f ms)\n",
+             (unsigned long long)d, d * 1e3 / F_CPU);
+    }
+  }
+}
+
+static void lcd_command(uint8_t cmd) {
+  if (cmd == 0x01) { memset(lcd.ddram, ' ', sizeof(lcd.ddram)); lcd.addr = 0; lcd.cgram = 0; }
+  else if ((cmd & 0xFE) == 0x02) { lcd.addr = 0; lcd.cgram = 0; }
+  else if (cmd & 0x80) { lcd.addr = cmd & 0x7F; lcd.cgram = 0; }
+  else if (cmd & 0x40) lcd.cgram = 1;
+  else if ((cmd & 0xF0) == 0x20) lcd.four_bit = 1;
+}
+
+static void lcd_data(uint8_t c) {
+  if (lcd.cgram) return;
+  int row = lcd.addr >= 0x40;
+  int col = lcd.addr - (row ? 0x40 : 0);
+  if (col >= 0 && col < 16) lcd.ddram[row][col] = c;
+  lcd.addr++;
+}
+
+// PCF8574-Byte: P0 RS, P1 RW, P2 EN, P3 Hintergrundbeleuchtung, P4-P7 = D4-D7
+static void lcd_port_write(uint8_t v) {
+  int en_falling = (lcd.last & 0x04) && !(v & 0x04);
+  lcd.last = v;
+  if (!en_falling) return;
+  uint8_t nibble = v >> 4;
+  int rs = v & 0x01;
+  if (!lcd.four_bit) {
+    // Initialisierung im 8-Bit-Modus, nur das obere Nibble zählt
+    lcd_command(nibble << 4);
+    return;
+  }
+  if (!lcd.nibble_high) {
+    lcd.pending = nibble << 4;
+    lcd.nibble_high = 1;
+    return;
+  }
+  lcd.nibble_high = 0;
+  uint8_t b = lcd.pending | nibble;
+  if (rs) lcd_data(b); else lcd_command(b);
+}
+
+static void lcd_twi_hook(struct avr_irq_t* irq, uint32_t value, void* param) {
+  avr_twi_msg_irq_t v;
+  v.u.v = value;
+  if (v.u.twi.msg & TWI_COND_STOP) lcd.selected = 0;
+  if (v.u.twi.msg & TWI_COND_START) {
+    lcd.selected = (v.u.twi.addr >> 1) == 0x27 ? v.u.twi.addr : 0;
+    if (lcd.selected) avr_raise_irq(lcd.irq + TWI_IRQ_INPUT, avr_twi_irq_msg(TWI_COND_ACK, lcd.selected, 1));
+  }
+  if (lcd.selected && (v.u.twi.msg & TWI_COND_WRITE)) {
+    avr_raise_irq(lcd.irq + TWI_IRQ_INPUT, avr_twi_irq_msg(TWI_COND_ACK, lcd.selected, 1));
+    lcd_port_write(v.u.twi.data);
+  }
+}
+
+static void lcd_print(avr_t* avr) {
+  // eigene Zeichen: 0 Cursor, 1 Haken, 2 Kreuz, 3 unendlich, 4 zurück, 5 Sanduhr
+  static const char glyphs[8] = {'>', 'v', 'x', '8', '<', 'Z', '6', '7'};
+  printf("[%9.3f ms] +----------------+\n", (double)avr->cycle / CYCLES_PER_MS);
+  for (int row = 0; row < 2; row++) {
+    printf("             |");
+    for (int col = 0; col < 16; col++) {
+      char c = lcd.ddram[row][col];
+      putchar((unsigned char)c < 8 ? glyphs[(int)c] : c);
+    }
+    printf("|\n");
+  }
+  printf("             +----------------+\n");
+}
+
+/* ===== Szenario ===== */
+
+typedef struct {
+  uint64_t t;               // Zyklus
+  avr_irq_t* pin;
+  int level;
+} action_t;
+
+static action_t actions[MAX_ACTIONS];
+static int nactions = 0;
+
+static void schedule(uint64_t t, avr_irq_t* pin, int level) {
+  if (nactions >= MAX_ACTIONS) { fprintf(stderr, "zu viele Pin-Aktionen\n"); exit(1); }
+  int i = nactions++;
+  while (i > 0 && actions[i - 1].t > t) { actions[i] = actions[i - 1]; i--; }
+  actions[i].t = t;
+  actions[i].pin = pin;
+  actions[i].level = level;
+}
+
+// eine Rastung = vier Zustände (CLK, DAT), Ruhelage beide high
+static void schedule_turn(uint64_t t, int right, int detents) {
+  static const uint8_t cw[4] = {0b01, 0b00, 0b10, 0b11};
+  static const uint8_t ccw[4] = {0b10, 0b00, 0b01, 0b11};
+  const uint8_t* seq = right ? cw : ccw;
+  for (int d = 0; d < detents; d++) {
+    for (int s = 0; s < 4; s++) {
+      t += 2 * CYCLES_PER_MS;
+      schedule(t, pin_clk, seq[s] >> 1);
+      schedule(t, pin_dat, seq[s] & 1);
+    }
+    t += 40 * CYCLES_PER_MS;
+  }
+}
+
+static void set_switch(uint64_t t, int pos) {
+  schedule(t, pin_sw1, pos != 1);
+  schedule(t, pin_sw2, pos != 2);
+}
+
+typedef struct {
+  uint64_t t;
+  char line[128];
+} step_t;
+
+static step_t* steps = NULL;
+static int nsteps = 0;
+static int next_step = 0;
+static int finished = 0;
+
+static void load_scenario(const char* path) {
+  FILE* f = fopen(path, "r");
+  if (!f) { perror(path); exit(1); }
+  char line[160];
+  double t_ms = 0;
+  while (fgets(line, sizeof(line), f)) {
+    char* hash = strchr(line, '#');
+    if (hash) *hash = 0;
+    char time[32];
+    int n;
+    if (sscanf(line, "%31s %n", time, &n) < 1) continue;
+    t_ms = time[0] == '+' ? t_ms + atof(time + 1) : atof(time);
+    steps = realloc(steps, (nsteps + 1) * sizeof(step_t));
+    steps[nsteps].t = (uint64_t)(t_ms * CYCLES_PER_MS);
+    strncpy(steps[nsteps].line, line + n, sizeof(steps[nsteps].line) - 1);
+    steps[nsteps].line[sizeof(steps[nsteps].line) - 1] = 0;
+    steps[nsteps].line[strcspn(steps[nsteps].line, "\n")] = 0;
+    nsteps++;
+  }
+  fclose(f);
+}
+
+static void run_step(avr_t* avr, const char* line) {
+  char cmd[32], arg[32] = "";
+  double value = 0;
+  int n = sscanf(line, "%31s %31s %lf", cmd, arg, &value);
+  if (n < 1) return;
+  uint64_t t = avr->cycle;
+  if (!strcmp(cmd, "mass")) mass_g = atof(arg);
+  else if (!strcmp(cmd, "flow")) flow_gps = atof(arg);
+  else if (!strcmp(cmd, "target")) { target_g = atof(arg); t_target_crossed = 0; }
+  else if (!strcmp(cmd, "noise")) hx.noise_g = atof(arg);
+  else if (!strcmp(cmd, "rate")) hx.rate_hz = atoi(arg);
+  else if (!strcmp(cmd, "tare")) hx.tare = atol(arg);
+  else if (!strcmp(cmd, "cal")) hx.cal = atof(arg);
+  else if (!strcmp(cmd, "switch")) set_switch(t, atoi(arg));
+  else if (!strcmp(cmd, "turn")) schedule_turn(t, strcmp(arg, "left") != 0, n >= 3 ? (int)value : 1);
+  else if (!strcmp(cmd, "click") || !strcmp(cmd, "longclick")) {
+    schedule(t, pin_btn, 0);
+    schedule(t + (cmd[0] == 'l' ? 700 : 100) * CYCLES_PER_MS, pin_btn, 1);
+  }
+  else if (!strcmp(cmd, "screen")) lcd_print(avr);
+  else if (!strcmp(cmd, "end")) finished = 1;
+  else fprintf(stderr, "unbekannter Szenario-Befehl: %s\n", line);
+}
+
+/* ===== Auswertung ===== */
+
+static int cmp_self(const void* a, const void* b) {
+  const func_t* fa = *(func_t* const*)a;
+  const func_t* fb = *(func_t* const*)b;
+  return fa->self_cycles < fb->self_cycles ? 1 : fa->self_cycles > fb->self_cycles ? -1 : 0;
+}
+
+static void report(avr_t* avr) {
+  printf("\n== Laufzeit: %llu Zyklen (%.1f ms), %u Flanken am Ausgang ==\n",
+         (unsigned long long)avr->cycle, (double)avr->cycle / CYCLES_PER_MS, output_edges);
+
+  printf("\n== Dauer pro Aufruf (inkl. Unterfunktionen) ==\n");
+  printf("%-28s %10s %10s %10s %10s\n", "Funktion", "Aufrufe", "min", "mittel", "max");
+  for (int i = 0; i < nfuncs; i++) {
+    func_t* fn = &funcs[i];
+    if (!fn->tracked || fn->incl_count == 0) continue;
+    printf("%-28.28s %10u %10llu %10llu %10llu\n", fn->name, fn->incl_count,
+           (unsigned long long)fn->incl_min, (unsigned long long)(fn->incl_total / fn->incl_count),
+           (unsigned long long)fn->incl_max);
+  }
+
+  printf("\n== Self-Zyklen je Funktion (Top 30) ==\n");
+  func_t* sorted[MAX_FUNCS];
+  for (int i = 0; i < nfuncs; i++) sorted[i] = &funcs[i];
+  qsort(sorted, nfuncs, sizeof(func_t*), cmp_self);
+  printf("%-48s %12s %6s %10s\n", "Funktion", "Zyklen", "%", "Aufrufe");
+  for (int i = 0; i < nfuncs && i < 30 && sorted[i]->self_cycles; i++) {
+    printf("%-48.48s %12llu %5.1f%% %10u\n", sorted[i]->name, (unsigned long long)sorted[i]->self_cycles,
+           100.0 * sorted[i]->self_cycles / avr->cycle, sorted[i]->calls);
+  }
+}
+
+/* ===== Hauptprogramm ===== */
+
+int main(int argc, char** argv) {
+  if (argc != 4) {
+    fprintf(stderr, "Aufruf: %s <firmware.elf> <firmware.sym> <szenario.txt>\n", argv[0]);
+    return 1;
+  }
+
+  elf_firmware_t fw;
+  memset(&fw, 0, sizeof(fw));
+  if (elf_read_firmware(argv[1], &fw)) { fprintf(stderr, "ELF nicht lesbar: %s\n", argv[1]); return 1; }
+  load_symbols(argv[2]);
+  load_scenario(argv[3]);
+
+  avr_t* avr = avr_make_mcu_by_name("atmega328p");
+  if (!avr) { fprintf(stderr, "atmega328p nicht verfügbar\n"); return 1; }
+  avr_init(avr);
+  fw.frequency = F_CPU;
+  avr_load_firmware(avr, &fw);
+
+  // HX711: D11 = PB3 (DOUT), D10 = PB2 (SCK)
+  hx.dout = avr_io_getirq(avr, AVR_IOCTL_IOPORT_GETIRQ('B'), 3);
+  avr_irq_register_notify(avr_io_getirq(avr, AVR_IOCTL_IOPORT_GETIRQ('B'), 2), hx711_sck_hook, avr);
+  hx.bit = -1;
+  hx.rate_hz = 10;
+  hx.tare = 8240259;     // DEFAULT_TAR_OFFSET
+  hx.cal = 28.44;        // DEFAULT_CAL_FACTOR
+  hx.t_next_conversion = 400 * CYCLES_PER_MS;   // erste Wandlung nach dem Einschalten
+  avr_raise_irq(hx.dout, 1);
+
+  // Ausgang: D8 = PB0
+  avr_irq_register_notify(avr_io_getirq(avr, AVR_IOCTL_IOPORT_GETIRQ('B'), 0), output_hook, avr);
+
+  // Dreh-Drück-Knopf: D3 CLK, D4 DAT, D2 Taster; VE-Schalter: D5 'I', D7 'II' (gegen D6 = low)
+  pin_clk = avr_io_getirq(avr, AVR_IOCTL_IOPORT_GETIRQ('D'), 3);
+  pin_dat = avr_io_getirq(avr, AVR_IOCTL_IOPORT_GETIRQ('D'), 4);
+  pin_btn = avr_io_getirq(avr, AVR_IOCTL_IOPORT_GETIRQ('D'), 2);
+  pin_sw1 = avr_io_getirq(avr, AVR_IOCTL_IOPORT_GETIRQ('D'), 5);
+  pin_sw2 = avr_io_getirq(avr, AVR_IOCTL_IOPORT_GETIRQ('D'), 7);
+  avr_raise_irq(pin_clk, 1);
+  avr_raise_irq(pin_dat, 1);
+  avr_raise_irq(pin_btn, 1);
+  avr_raise_irq(pin_sw1, 1);
+  avr_raise_irq(pin_sw2, 1);
+
+  // LCD: PCF8574 an TWI, Adresse 0x27
+  static const char* twi_names[2] = {"lcd.twi.in", "lcd.twi.out"};
+  memset(lcd.ddram, ' ', sizeof(lcd.ddram));
+  lcd.irq = avr_alloc_irq(&avr->irq_pool, 0, 2, twi_names);
+  avr_irq_register_notify(lcd.irq + TWI_IRQ_OUTPUT, lcd_twi_hook, avr);
+  avr_connect_irq(lcd.irq + TWI_IRQ_INPUT, avr_io_getirq(avr, AVR_IOCTL_TWI_GETIRQ(0), TWI_IRQ_INPUT));
+  avr_connect_irq(avr_io_getirq(avr, AVR_IOCTL_TWI_GETIRQ(0), TWI_IRQ_OUTPUT), lcd.irq + TWI_IRQ_OUTPUT);
+
+  uint64_t t_next_ms = CYCLES_PER_MS;
+  int state = cpu_Running;
+  while (!finished && state != cpu_Done && state != cpu_Crashed) {
+    uint32_t pc = avr->pc;
+    uint64_t cycle = avr->cycle;
+    state = avr_run(avr);
+    account(avr, pc, avr->cycle - cycle);
+
+    while (nactions > 0 && actions[0].t <= avr->cycle) {
+      avr_raise_irq(actions[0].pin, actions[0].level);
+      memmove(actions, actions + 1, --nactions * sizeof(action_t));
+    }
+    while (next_step < nsteps && steps[next_step].t <= avr->cycle) run_step(avr, steps[next_step++].line);
+
+    if (avr->cycle >= hx.t_next_conversion) {
+      hx711_conversion(avr);
+      hx.t_next_conversion += F_CPU / hx.rate_hz;
+    }
+
+    // Befüllung im 1-ms-Raster
+    if (avr->cycle >= t_next_ms) {
+      t_next_ms += CYCLES_PER_MS;
+      if (output_state) mass_g += flow_gps / 1000.0;
+      if (target_g >= 0 && !t_target_crossed && mass_g >= target_g) t_target_crossed = avr->cycle;
+    }
+  }
+  if (state == cpu_Crashed) fprintf(stderr, "CPU abgestürzt bei PC 0x%04x\n", avr->pc);
+
+  report(avr);
+  return state == cpu_Crashed;
+}
@@ -0,0 +1,21 @@
+#!/bin/sh
+# Baut Firmware und Profiler und lässt ein Szenario in simavr laufen.
+#
+#   tools/simavr/run.sh [szenario.txt]     (Standard: scenarios/fill_no_preset.txt)
+#
+# Benötigt PlatformIO (pio), avr-nm aus der AVR-Toolchain und simavr.
+
+set -e
+
+HERE=$(cd "$(dirname "$0")" && pwd)
+PROJECT=$(cd "$HERE/../.." && pwd)
+BUILD="$PROJECT/.pio/build/nanoatmega328new"
+SCENARIO=${1:-$HERE/scenarios/fill_no_preset.txt}
+
+(cd "$PROJECT" && pio run -e nanoatmega328new)
+make -C "$HERE" profiler
+
+NM=$(command -v avr-nm || echo "$HOME/.platformio/packages/toolchain-atmelavr/bin/avr-nm")
+"$NM" -n -C --defined-only "$BUILD/firmware.elf" > "$BUILD/firmware.sym"
+
+"$HERE/profiler" "$BUILD/firmware.elf" "$BUILD/firmware.sym" "$SCENARIO"